@@ -1,6 +1,9 @@
+#include <atomic>
 #include <functional>
+#include <memory>
 
 #include "../../src/base/include/Logging.h"
+#include "../../src/base/include/ShardedLogging.h"
 #include "../../src/base/include/Timestamp.h"
 #include "../../src/net/include/Buffer.h"
 #include "../../src/net/include/Callbacks.h"
@@ -27,6 +30,10 @@ class EchoServer {
   }
   void start() { server_.start(); }
 
+  void setThreadInitCallback(const TcpServer::ThreadInitCallback &cb) {
+    server_.setThreadInitCallback(cb);
+  }
+
  private:
   void onConnection(const TcpConnectionPtr &conn) {
     if (conn->connected()) {
@@ -50,11 +57,26 @@ class EchoServer {
   TcpServer server_;
 };
 
-int main() {
+int main(int argc, char *argv[]) {
   // Logger::setLogLevel(Logger::TRACE);
+  // 指定 basename 时每个 subloop 写入自己的日志分片 basename.loopN.*.log
+  std::unique_ptr<ShardedLogging> shardedLog;
+  std::atomic_int numLoops(0);
+
   EventLoop loop;
   InetAddress addr(8086);
   EchoServer server(&loop, addr, "EchoServer");
+  if (argc > 1) {
+    shardedLog.reset(new ShardedLogging(argv[1], 500 * 1000 * 1000));
+    ShardedLogging *log = shardedLog.get();
+    Logger::setOutput(std::bind(&ShardedLogging::append, log,
+                                std::placeholders::_1, std::placeholders::_2));
+    server.setThreadInitCallback([log, &numLoops](EventLoop *ioLoop) {
+      log->attachThread("loop" + std::to_string(numLoops++));
+      ioLoop->runEvery(3.0, [log]() { log->flush(); });
+    });
+  }
+
   server.start();
   loop.loop();
   return 0;
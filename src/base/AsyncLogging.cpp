@@ -5,44 +5,300 @@
 #include <iostream>
 
 #include "include/LogFile.h"
+#include "include/LogStream.h"
+#include "include/Timestamp.h"
 
 using namespace TinyWeb::base;
 
+std::atomic<uint64_t> AsyncLogging::numCreated_(0);
+
 AsyncLogging::AsyncLogging(const std::string& basename, off_t rollSize,
-                           int flushInterval)
+                           int flushInterval, Mode mode)
     : flushInterval_(flushInterval),
       running_(false),
       basename_(basename),
       rollSize_(rollSize),
+      mode_(mode),
+      id_(++numCreated_),
       thread_(std::bind(&AsyncLogging::threadFunc, this), "Logging"),
       mutex_(),
       cond_(),
       currentBuffer_(new Buffer),
       nextBuffer_(new Buffer),
-      buffers_() {
+      buffers_(),
+      stageFull_(false),
+      pendingBuffers_(0),
+      overflowPolicy_(kUnbounded),
+      maxBuffers_(16),
+      sampleN_(100),
+      sampleCount_(0),
+      droppedLines_(0),
+      droppedBytes_(0),
+      unreportedLines_(0),
+      unreportedBytes_(0) {
   currentBuffer_->bzero();
   nextBuffer_->bzero();
   buffers_.reserve(16);
 }
 
 void AsyncLogging::append(const char* logline, int len) {
-  std::lock_guard<std::mutex> lock(mutex_);
-  if (currentBuffer_->avail() > len) {
-    currentBuffer_->append(logline, len);
+  if (mode_ == kThreadLocalBuffer) {
+    appendThreadLocal(logline, len, false);
+  } else {
+    appendShared(logline, len, false);
+  }
+}
+
+void AsyncLogging::appendCritical(const char* logline, int len) {
+  if (mode_ == kThreadLocalBuffer) {
+    appendThreadLocal(logline, len, true);
+  } else {
+    appendShared(logline, len, true);
+  }
+}
+
+void AsyncLogging::appendShared(const char* logline, int len, bool critical) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (;;) {
+    bool overload = !critical && overloaded(buffers_.size());
+    if (overload && !sampled(&sampleCount_)) {
+      dropLine(len);
+      return;
+    }
+
+    if (currentBuffer_->avail() > len) {
+      currentBuffer_->append(logline, len);
+      return;
+    }
+
+    if (!overload) {
+      break;
+    }
+    if (overflowPolicy_ != kBlock) {
+      dropLine(len);
+      return;
+    }
+    notFull_.wait(lock, [this]() {
+      return !overloaded(buffers_.size()) || !running_;
+    });
+    if (!running_) {
+      break;
+    }
+  }
+
+  buffers_.push_back(std::move(currentBuffer_));
+  if (nextBuffer_) {
+    currentBuffer_ = std::move(nextBuffer_);
   } else {
-    buffers_.push_back(std::move(currentBuffer_));
-    if (nextBuffer_) {
-      currentBuffer_ = std::move(nextBuffer_);
+    currentBuffer_.reset(new Buffer);
+  }
+  currentBuffer_->append(logline, len);
+  cond_.notify_one();
+}
+
+void AsyncLogging::appendThreadLocal(const char* logline, int len,
+                                     bool critical) {
+  Stage* stage = localStage();
+  for (;;) {
+    bool overload = !critical && overloaded(pendingBuffers_.load());
+    {
+      // 只有后端收集时才会与本线程竞争这把锁
+      std::lock_guard<std::mutex> lock(stage->mutex);
+      if (overload && !sampled(&stage->sampleCount)) {
+        dropLine(len);
+        return;
+      }
+
+      if (stage->current->avail() > len) {
+        stage->current->append(logline, len);
+        return;
+      }
+
+      if (!overload || !running_) {
+        stage->full.push_back(std::move(stage->current));
+        if (stage->next) {
+          stage->current = std::move(stage->next);
+        } else {
+          stage->current.reset(new Buffer);
+        }
+        stage->current->append(logline, len);
+        ++pendingBuffers_;
+        break;
+      }
+
+      if (overflowPolicy_ != kBlock) {
+        dropLine(len);
+        return;
+      }
+    }
+    waitNotFull();
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stageFull_ = true;
+  }
+  cond_.notify_one();
+}
+
+void AsyncLogging::dropLine(int len) {
+  ++droppedLines_;
+  droppedBytes_ += len;
+  ++unreportedLines_;
+  unreportedBytes_ += len;
+}
+
+void AsyncLogging::waitNotFull() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  notFull_.wait(lock, [this]() {
+    return !overloaded(pendingBuffers_.load()) || !running_;
+  });
+}
+
+void AsyncLogging::writeBuffers(LogFile* output,
+                                const BufferVector& buffers) {
+  if (!fileOptions_.directWrite) {
+    for (const auto& buffer : buffers) {
+      output->append(buffer->data(), buffer->length());
+    }
+    return;
+  }
+
+  std::vector<struct iovec> iov;
+  iov.reserve(buffers.size());
+  for (const auto& buffer : buffers) {
+    struct iovec vec;
+    vec.iov_base = const_cast<char*>(buffer->data());
+    vec.iov_len = buffer->length();
+    iov.push_back(vec);
+  }
+  if (!iov.empty()) {
+    output->append(iov.data(), static_cast<int>(iov.size()));
+  }
+}
+
+void AsyncLogging::writeDropMarker(LogFile* output) {
+  uint64_t lines = unreportedLines_.exchange(0);
+  if (lines == 0) {
+    return;
+  }
+  uint64_t bytes = unreportedBytes_.exchange(0);
+
+  if (dropMarker_) {
+    std::string marker = dropMarker_(lines, bytes);
+    output->append(marker.data(), static_cast<int>(marker.size()));
+    return;
+  }
+
+  LogStream stream;
+  stream << Timestamp::now().toString() << " WARN  dropped " << lines
+         << " messages (" << bytes << " bytes) - AsyncLogging\n";
+  output->append(stream.buffer().data(), stream.buffer().length());
+}
+
+AsyncLogging::Stage* AsyncLogging::localStage() {
+  static thread_local uint64_t t_owner = 0;
+  static thread_local StagePtr t_stage;
+
+  if (t_owner != id_) {
+    std::thread::id tid = std::this_thread::get_id();
+    std::lock_guard<std::mutex> lock(mutex_);
+    StagePtr stage;
+    for (const StagePtr& s : stages_) {
+      if (s->tid == tid) {
+        stage = s;
+        break;
+      }
+    }
+    if (!stage) {
+      stage = std::make_shared<Stage>();
+      stage->tid = tid;
+      stage->current.reset(new Buffer);
+      stages_.push_back(stage);
+    }
+    t_stage = stage;
+    t_owner = id_;
+  }
+  return t_stage.get();
+}
+
+// spares 为后端线程已写出并重置的缓冲区，用完再分配新的，返回收集的线程数
+size_t AsyncLogging::collectStages(BufferVector* buffersToWrite,
+                                   BufferVector* spares) {
+  std::vector<StagePtr> stages;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stages = stages_;
+  }
+
+  for (const StagePtr& stage : stages) {
+    // 备用缓冲区在锁外准备，但生产者可能在加锁前用掉 next，锁内需再检查
+    BufferPtr spare;
+    if (spares->empty()) {
+      spare.reset(new Buffer);
     } else {
-      currentBuffer_.reset(new Buffer);
+      spare = std::move(spares->back());
+      spares->pop_back();
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(stage->mutex);
+      pendingBuffers_ -= stage->full.size();
+      for (BufferPtr& buffer : stage->full) {
+        buffersToWrite->push_back(std::move(buffer));
+      }
+      stage->full.clear();
+
+      if (stage->current->length() > 0) {
+        buffersToWrite->push_back(std::move(stage->current));
+        if (stage->next) {
+          stage->current = std::move(stage->next);
+        } else {
+          stage->current = std::move(spare);
+        }
+      }
+      if (!stage->next && spare) {
+        stage->next = std::move(spare);
+      }
+    }
+    if (spare) {
+      spares->push_back(std::move(spare));
     }
-    currentBuffer_->append(logline, len);
-    cond_.notify_one();
   }
+
+  size_t numStages = stages.size();
+  stages.clear();
+
+  // 线程退出后只剩 stages_ 持有引用，清空后即可回收
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto it = stages_.begin(); it != stages_.end();) {
+    if (it->use_count() == 1) {
+      std::lock_guard<std::mutex> stageLock((*it)->mutex);
+      if ((*it)->full.empty() && (*it)->current->length() == 0) {
+        it = stages_.erase(it);
+        continue;
+      }
+    }
+    ++it;
+  }
+  return numStages;
 }
 
 void AsyncLogging::threadFunc() {
-  LogFile output(basename_, rollSize_, flushInterval_, false);
+  if (mode_ == kThreadLocalBuffer) {
+    threadFuncThreadLocal();
+  } else {
+    threadFuncShared();
+  }
+}
+
+void AsyncLogging::threadFuncShared() {
+  LogFile output(basename_, rollSize_, flushInterval_, false, fileHeader_,
+                 fileOptions_);
+  if (compressor_) {
+    output.setRollCallback(std::bind(&LogCompressor::compress,
+                                     compressor_.get(), std::placeholders::_1));
+  }
 
   BufferPtr newBuffer1(new Buffer);
   BufferPtr newBuffer2(new Buffer);
@@ -70,12 +326,12 @@ void AsyncLogging::threadFunc() {
         nextBuffer_ = std::move(newBuffer2);
       }
     }
+    notFull_.notify_all();
 
     assert(!buffersToWrite.empty());
 
-    for (const auto& buffer : buffersToWrite) {
-      output.append(buffer->data(), buffer->length());
-    }
+    writeBuffers(&output, buffersToWrite);
+    writeDropMarker(&output);
 
     if (buffersToWrite.size() > 2) {
       buffersToWrite.resize(2);
@@ -96,5 +352,66 @@ void AsyncLogging::threadFunc() {
     buffersToWrite.clear();
     output.flush();
   }
+
+  // stop() 之后写出剩余日志
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    buffersToWrite.swap(buffers_);
+    writeBuffers(&output, buffersToWrite);
+    output.append(currentBuffer_->data(), currentBuffer_->length());
+    currentBuffer_->reset();
+  }
+  writeDropMarker(&output);
+  output.flush();
+}
+
+void AsyncLogging::threadFuncThreadLocal() {
+  LogFile output(basename_, rollSize_, flushInterval_, false, fileHeader_,
+                 fileOptions_);
+  if (compressor_) {
+    output.setRollCallback(std::bind(&LogCompressor::compress,
+                                     compressor_.get(), std::placeholders::_1));
+  }
+
+  BufferVector buffersToWrite;
+  buffersToWrite.reserve(16);
+  BufferVector spares;
+
+  while (running_) {
+    assert(buffersToWrite.empty());
+
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      if (!stageFull_) {
+        cond_.wait_for(lock, std::chrono::seconds(flushInterval_));
+      }
+      stageFull_ = false;
+    }
+
+    size_t numStages = collectStages(&buffersToWrite, &spares);
+    {
+      // 与 waitNotFull 的检查同步，避免唤醒丢失
+      std::lock_guard<std::mutex> lock(mutex_);
+    }
+    notFull_.notify_all();
+
+    writeBuffers(&output, buffersToWrite);
+    writeDropMarker(&output);
+
+    // 每个线程下次最多需要一个备用缓冲区，多余的释放
+    for (BufferPtr& buffer : buffersToWrite) {
+      if (spares.size() >= numStages) {
+        break;
+      }
+      buffer->reset();
+      spares.push_back(std::move(buffer));
+    }
+    buffersToWrite.clear();
+    output.flush();
+  }
+
+  collectStages(&buffersToWrite, &spares);
+  writeBuffers(&output, buffersToWrite);
+  writeDropMarker(&output);
   output.flush();
-}
\ No newline at end of file
+}
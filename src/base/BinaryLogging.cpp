@@ -0,0 +1,463 @@
+#include "include/BinaryLogging.h"
+
+#include "include/FlightRecorder.h"
+
+#include <stdlib.h>
+
+#include <mutex>
+#include <vector>
+
+using namespace TinyWeb::base;
+
+extern const char* getLevelName[Logger::LogLevel::LEVEL_COUNT];
+extern Logger::OutputFunc g_output;
+extern Logger::FlushFunc g_flush;
+
+const char BinaryLogDecoder::kMagic[] = "TWBLOG1\n";
+
+namespace {
+Logger::OutputFunc g_binaryOutput;
+Logger::FlushFunc g_binaryFlush;
+Logger::OutputFunc g_siteOutput;
+
+std::mutex g_sitesMutex;
+std::vector<const LogSite*> g_sites;
+
+const int kMaxVarintSize = 10;
+
+int encodeVarint(uint64_t v, char* out) {
+  int n = 0;
+  while (v >= 0x80) {
+    out[n++] = static_cast<char>((v & 0x7f) | 0x80);
+    v >>= 7;
+  }
+  out[n++] = static_cast<char>(v);
+  return n;
+}
+
+bool decodeVarint(const char** cur, const char* end, uint64_t* v) {
+  uint64_t result = 0;
+  for (int shift = 0; shift < 64 && *cur < end; shift += 7) {
+    uint8_t byte = static_cast<uint8_t>(*(*cur)++);
+    result |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      *v = result;
+      return true;
+    }
+  }
+  return false;
+}
+
+uint64_t zigzag(int64_t v) {
+  return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+}
+
+int64_t unzigzag(uint64_t v) {
+  return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+}
+
+void appendSite(const LogSite* site, std::string* out) {
+  char buf[4 * kMaxVarintSize + 2];
+  char* cur = buf;
+  *cur++ = 'S';
+  cur += encodeVarint(site->id.load(std::memory_order_relaxed), cur);
+  *cur++ = static_cast<char>(site->level);
+  cur += encodeVarint(static_cast<uint64_t>(site->line), cur);
+  cur += encodeVarint(static_cast<uint64_t>(site->basename.size_), cur);
+  out->append(buf, cur - buf);
+  out->append(site->basename.data_, site->basename.size_);
+
+  size_t funcLen = site->func ? strlen(site->func) : 0;
+  out->append(buf, encodeVarint(funcLen, buf));
+  if (funcLen) {
+    out->append(site->func, funcLen);
+  }
+}
+
+// 首次使用时注册调用点，并返回需要内联输出的站点定义
+uint32_t registerSite(LogSite* site, std::string* definition) {
+  std::lock_guard<std::mutex> lock(g_sitesMutex);
+  uint32_t id = site->id.load(std::memory_order_relaxed);
+  if (id == 0) {
+    g_sites.push_back(site);
+    id = static_cast<uint32_t>(g_sites.size());
+    site->id.store(id, std::memory_order_release);
+    appendSite(site, definition);
+  }
+  return id;
+}
+
+void formatRecord(const char* basename, int basenameLen, int line, int level,
+                  const char* func, int funcLen, int64_t microSecondsSinceEpoch,
+                  const char* payload, const char* end, LogStream* stream) {
+  std::string time = Timestamp(microSecondsSinceEpoch).toString();
+  *stream << GeneralTemplate(time.data(), static_cast<int>(time.size()))
+          << ' ';
+  if (level >= 0 && level < Logger::LEVEL_COUNT) {
+    *stream << GeneralTemplate(getLevelName[level], 6);
+  }
+  if (funcLen > 0) {
+    *stream << GeneralTemplate(func, funcLen) << ' ';
+  }
+
+  const char* cur = payload;
+  while (cur < end) {
+    char type = *cur++;
+    uint64_t v = 0;
+    if (type == BinaryLogStream::kSigned) {
+      if (!decodeVarint(&cur, end, &v)) break;
+      *stream << static_cast<long long>(unzigzag(v));
+    } else if (type == BinaryLogStream::kUnsigned) {
+      if (!decodeVarint(&cur, end, &v)) break;
+      *stream << static_cast<unsigned long long>(v);
+    } else if (type == BinaryLogStream::kHex) {
+      if (!decodeVarint(&cur, end, &v)) break;
+      *stream << Hex(v);
+    } else if (type == BinaryLogStream::kDouble) {
+      if (end - cur < static_cast<ptrdiff_t>(sizeof(double))) break;
+      double d;
+      memcpy(&d, cur, sizeof(d));
+      cur += sizeof(d);
+      *stream << d;
+    } else if (type == BinaryLogStream::kChar) {
+      if (cur >= end) break;
+      *stream << *cur++;
+    } else if (type == BinaryLogStream::kString) {
+      if (!decodeVarint(&cur, end, &v) ||
+          v > static_cast<uint64_t>(end - cur)) {
+        break;
+      }
+      *stream << GeneralTemplate(cur, static_cast<int>(v));
+      cur += v;
+    } else {
+      break;
+    }
+  }
+
+  *stream << " - " << GeneralTemplate(basename, basenameLen) << ':' << line
+          << '\n';
+}
+
+// 参数逐个按类型标记跳过，恰好结束在末尾才是完整的参数区
+bool validPayload(const char* cur, const char* end) {
+  while (cur < end) {
+    char type = *cur++;
+    uint64_t v = 0;
+    if (type == BinaryLogStream::kSigned ||
+        type == BinaryLogStream::kUnsigned || type == BinaryLogStream::kHex) {
+      if (!decodeVarint(&cur, end, &v)) return false;
+    } else if (type == BinaryLogStream::kDouble) {
+      if (end - cur < static_cast<ptrdiff_t>(sizeof(double))) return false;
+      cur += sizeof(double);
+    } else if (type == BinaryLogStream::kChar) {
+      if (cur >= end) return false;
+      ++cur;
+    } else if (type == BinaryLogStream::kString) {
+      if (!decodeVarint(&cur, end, &v) ||
+          v > static_cast<uint64_t>(end - cur)) {
+        return false;
+      }
+      cur += v;
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+}  // namespace
+
+BinaryLogStream& BinaryLogStream::operator<<(long long v) {
+  if (buffer_.avail() > kMaxVarintSize + 1) {
+    char* cur = buffer_.current();
+    *cur++ = kSigned;
+    buffer_.add(1 + encodeVarint(zigzag(v), cur));
+  }
+  return *this;
+}
+
+BinaryLogStream& BinaryLogStream::operator<<(unsigned long long v) {
+  if (buffer_.avail() > kMaxVarintSize + 1) {
+    char* cur = buffer_.current();
+    *cur++ = kUnsigned;
+    buffer_.add(1 + encodeVarint(v, cur));
+  }
+  return *this;
+}
+
+BinaryLogStream& BinaryLogStream::operator<<(const Hex& h) {
+  if (buffer_.avail() > kMaxVarintSize + 1) {
+    char* cur = buffer_.current();
+    *cur++ = kHex;
+    buffer_.add(1 + encodeVarint(h.value_, cur));
+  }
+  return *this;
+}
+
+BinaryLogStream& BinaryLogStream::operator<<(double v) {
+  if (buffer_.avail() > static_cast<int>(sizeof(v)) + 1) {
+    char* cur = buffer_.current();
+    *cur++ = kDouble;
+    memcpy(cur, &v, sizeof(v));
+    buffer_.add(1 + sizeof(v));
+  }
+  return *this;
+}
+
+BinaryLogStream& BinaryLogStream::operator<<(char c) {
+  if (buffer_.avail() > 2) {
+    char* cur = buffer_.current();
+    cur[0] = kChar;
+    cur[1] = c;
+    buffer_.add(2);
+  }
+  return *this;
+}
+
+BinaryLogStream& BinaryLogStream::operator<<(const char* str) {
+  if (str) {
+    appendString(str, strlen(str));
+  } else {
+    appendString("(null)", 6);
+  }
+  return *this;
+}
+
+void BinaryLogStream::appendString(const char* data, size_t len) {
+  int avail = buffer_.avail() - kMaxVarintSize - 2;
+  if (avail <= 0) {
+    return;
+  }
+  if (len > static_cast<size_t>(avail)) {
+    len = static_cast<size_t>(avail);
+  }
+  char* cur = buffer_.current();
+  *cur++ = kString;
+  int n = encodeVarint(len, cur);
+  memcpy(cur + n, data, len);
+  buffer_.add(1 + n + len);
+}
+
+BinaryLogger::BinaryLogger(LogSite* site)
+    : site_(site),
+      lengthOffset_(0),
+      microSecondsSinceEpoch_(Timestamp::now().microSecondsSinceEpoch()) {
+  uint32_t id = site->id.load(std::memory_order_acquire);
+  if (id == 0 && g_binaryOutput) {
+    std::string definition;
+    id = registerSite(site, &definition);
+    if (!definition.empty()) {
+      const Logger::OutputFunc& out = g_siteOutput ? g_siteOutput
+                                                   : g_binaryOutput;
+      out(definition.data(), static_cast<int>(definition.size()));
+    }
+  }
+
+  BinaryLogStream::Buffer& buf = stream_.buffer_;
+  char* cur = buf.current();
+  *cur++ = 'R';
+  cur += encodeVarint(id, cur);
+  memcpy(cur, &microSecondsSinceEpoch_, sizeof(microSecondsSinceEpoch_));
+  cur += sizeof(microSecondsSinceEpoch_);
+  buf.add(cur - buf.current());
+  lengthOffset_ = buf.length();
+  buf.add(sizeof(uint16_t));
+}
+
+BinaryLogger::~BinaryLogger() {
+  BinaryLogStream::Buffer& buf = stream_.buffer_;
+  const char* payload = buf.data() + lengthOffset_ + sizeof(uint16_t);
+  const char* end = buf.data() + buf.length();
+
+  const bool fatal = site_->level == Logger::FATAL;
+  if (g_binaryOutput) {
+    uint16_t len = static_cast<uint16_t>(end - payload);
+    char* lengthField = buf.current() - buf.length() + lengthOffset_;
+    memcpy(lengthField, &len, sizeof(len));
+    g_binaryOutput(buf.data(), buf.length());
+  }
+  // FATAL 同时以文本写入 FlightRecorder，dump 中能看到终止原因
+  if (!g_binaryOutput || (fatal && FlightRecorder::enabled())) {
+    LogStream stream;
+    const char* func = site_->func;
+    formatRecord(site_->basename.data_, site_->basename.size_, site_->line,
+                 site_->level, func, func ? static_cast<int>(strlen(func)) : 0,
+                 microSecondsSinceEpoch_, payload, end, &stream);
+    if (!g_binaryOutput) {
+      g_output(stream.buffer().data(), stream.buffer().length());
+    }
+    if (fatal) {
+      FlightRecorder::record(stream.buffer().data(), stream.buffer().length());
+    }
+  }
+
+  if (fatal) {
+    if (g_binaryOutput && g_binaryFlush) {
+      g_binaryFlush();
+    } else {
+      g_flush();
+    }
+    FlightRecorder::dump();
+    abort();
+  }
+}
+
+void BinaryLogger::setOutput(Logger::OutputFunc out) { g_binaryOutput = out; }
+
+void BinaryLogger::setFlush(Logger::FlushFunc flush) { g_binaryFlush = flush; }
+
+void BinaryLogger::setSiteOutput(Logger::OutputFunc out) { g_siteOutput = out; }
+
+std::string BinaryLogger::fileHeader() {
+  std::string header(BinaryLogDecoder::kMagic,
+                     BinaryLogDecoder::kMagicLength);
+  std::lock_guard<std::mutex> lock(g_sitesMutex);
+  for (const LogSite* site : g_sites) {
+    appendSite(site, &header);
+  }
+  return header;
+}
+
+std::string BinaryLogger::dropMarker(uint64_t lines, uint64_t bytes) {
+  char buf[1 + sizeof(int64_t) + 2 * kMaxVarintSize];
+  char* cur = buf;
+  *cur++ = 'D';
+  int64_t microSecondsSinceEpoch = Timestamp::now().microSecondsSinceEpoch();
+  memcpy(cur, &microSecondsSinceEpoch, sizeof(microSecondsSinceEpoch));
+  cur += sizeof(microSecondsSinceEpoch);
+  cur += encodeVarint(lines, cur);
+  cur += encodeVarint(bytes, cur);
+  return std::string(buf, cur - buf);
+}
+
+int BinaryLogDecoder::decode(const char* data, size_t len,
+                             const OutputFunc& output) {
+  const char* end = data + len;
+  int errors = 0;
+
+  // 第一遍：收集站点定义，文件头和内联定义都可能出现在记录之后
+  for (int pass = 0; pass < 2; ++pass) {
+    const char* cur = data;
+    bool resync = false;
+    while (cur < end) {
+      if (end - cur >= kMagicLength &&
+          memcmp(cur, kMagic, kMagicLength) == 0) {
+        cur += kMagicLength;
+        resync = false;
+        continue;
+      }
+
+      const char* next = decodeRecord(cur, end, pass == 1, resync, output,
+                                      &errors);
+      if (next) {
+        cur = next;
+        resync = false;
+      } else {
+        // 逐字节向后查找下一条完整的记录，连续的坏数据只计一次
+        if (!resync && pass == 1) {
+          ++errors;
+        }
+        resync = true;
+        ++cur;
+      }
+    }
+  }
+  return errors;
+}
+
+const char* BinaryLogDecoder::decodeRecord(const char* cur, const char* end,
+                                           bool emit, bool resync,
+                                           const OutputFunc& output,
+                                           int* errors) {
+  char type = *cur++;
+  if (type == 'D') {
+    // 'D' 没有可校验的字段，查找记录边界时不接受
+    int64_t microSecondsSinceEpoch = 0;
+    uint64_t lines = 0, bytes = 0;
+    if (resync || end - cur < static_cast<ptrdiff_t>(
+                                  sizeof(microSecondsSinceEpoch))) {
+      return nullptr;
+    }
+    memcpy(&microSecondsSinceEpoch, cur, sizeof(microSecondsSinceEpoch));
+    cur += sizeof(microSecondsSinceEpoch);
+    if (!decodeVarint(&cur, end, &lines) ||
+        !decodeVarint(&cur, end, &bytes)) {
+      return nullptr;
+    }
+    if (emit) {
+      // 与 AsyncLogging 文本格式下的丢弃提示一致
+      LogStream stream;
+      std::string time = Timestamp(microSecondsSinceEpoch).toString();
+      stream << GeneralTemplate(time.data(), static_cast<int>(time.size()))
+             << " WARN  dropped " << lines << " messages (" << bytes
+             << " bytes) - AsyncLogging\n";
+      output(stream.buffer().data(), stream.buffer().length());
+    }
+    return cur;
+  }
+
+  uint64_t id = 0;
+  if ((type != 'S' && type != 'R') || !decodeVarint(&cur, end, &id) ||
+      id == 0 || id > UINT32_MAX) {
+    return nullptr;
+  }
+
+  if (type == 'S') {
+    uint64_t line = 0, fileLen = 0, funcLen = 0;
+    if (cur >= end) return nullptr;
+    int level = static_cast<uint8_t>(*cur++);
+    if (level >= Logger::LEVEL_COUNT || !decodeVarint(&cur, end, &line) ||
+        !decodeVarint(&cur, end, &fileLen) || fileLen == 0 ||
+        fileLen > static_cast<uint64_t>(end - cur)) {
+      return nullptr;
+    }
+    const char* file = cur;
+    cur += fileLen;
+    if (!decodeVarint(&cur, end, &funcLen) ||
+        funcLen > static_cast<uint64_t>(end - cur)) {
+      return nullptr;
+    }
+    if (!emit) {
+      SiteInfo& info = sites_[static_cast<uint32_t>(id)];
+      info.basename.assign(file, fileLen);
+      info.line = static_cast<int>(line);
+      info.level = level;
+      info.func.assign(cur, funcLen);
+    }
+    return cur + funcLen;
+  }
+
+  int64_t microSecondsSinceEpoch = 0;
+  uint16_t payloadLen = 0;
+  if (end - cur < static_cast<ptrdiff_t>(sizeof(microSecondsSinceEpoch) +
+                                           sizeof(payloadLen))) {
+    return nullptr;
+  }
+  memcpy(&microSecondsSinceEpoch, cur, sizeof(microSecondsSinceEpoch));
+  cur += sizeof(microSecondsSinceEpoch);
+  memcpy(&payloadLen, cur, sizeof(payloadLen));
+  cur += sizeof(payloadLen);
+  if (payloadLen > end - cur || !validPayload(cur, cur + payloadLen)) {
+    return nullptr;
+  }
+  const char* payload = cur;
+  cur += payloadLen;
+  if (!emit) {
+    return cur;
+  }
+
+  auto it = sites_.find(static_cast<uint32_t>(id));
+  if (it == sites_.end()) {
+    if (!resync) {
+      ++*errors;
+    }
+    return cur;
+  }
+  const SiteInfo& info = it->second;
+  LogStream stream;
+  formatRecord(info.basename.data(), static_cast<int>(info.basename.size()),
+               info.line, info.level, info.func.data(),
+               static_cast<int>(info.func.size()), microSecondsSinceEpoch,
+               payload, payload + payloadLen, &stream);
+  output(stream.buffer().data(), stream.buffer().length());
+  return cur;
+}
\ No newline at end of file
@@ -0,0 +1,190 @@
+#include "include/CpuTopology.h"
+
+#include <dirent.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+
+using namespace TinyWeb::base;
+
+namespace {
+// 读取只有一行的 sysfs 文件，失败返回空串
+std::string readLine(const std::string &path) {
+  FILE *fp = ::fopen(path.c_str(), "re");
+  if (fp == nullptr) {
+    return std::string();
+  }
+  char buf[4096];
+  std::string line;
+  if (::fgets(buf, sizeof(buf), fp) != nullptr) {
+    line = buf;
+    while (!line.empty() && (line.back() == '\n' || line.back() == ' ')) {
+      line.pop_back();
+    }
+  }
+  ::fclose(fp);
+  return line;
+}
+
+int readInt(const std::string &path, int defaultValue) {
+  std::string line = readLine(path);
+  return line.empty() ? defaultValue : atoi(line.c_str());
+}
+}  // namespace
+
+const CpuTopology &CpuTopology::instance() {
+  static CpuTopology topology;
+  return topology;
+}
+
+CpuTopology::CpuTopology(const std::string &sysfsRoot, bool allowedOnly)
+    : numNodes_(1) {
+  std::vector<int> online = parseCpuList(readLine(sysfsRoot + "/cpu/online"));
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  if (allowedOnly && ::sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+    allowedOnly = false;
+  }
+
+  // NUMA 节点从 node/nodeN/cpulist 得到，没有该目录时全部视为节点 0
+  std::map<int, int> nodeOfCpu;
+  DIR *dir = ::opendir((sysfsRoot + "/node").c_str());
+  if (dir != nullptr) {
+    int maxNode = 0;
+    while (struct dirent *ent = ::readdir(dir)) {
+      int node = 0;
+      if (::sscanf(ent->d_name, "node%d", &node) != 1) {
+        continue;
+      }
+      std::string list = readLine(sysfsRoot + "/node/" + ent->d_name +
+                                  "/cpulist");
+      for (int cpu : parseCpuList(list)) {
+        nodeOfCpu[cpu] = node;
+      }
+      maxNode = std::max(maxNode, node);
+    }
+    ::closedir(dir);
+    numNodes_ = maxNode + 1;
+  }
+
+  for (int id : online) {
+    if (allowedOnly && (id >= CPU_SETSIZE || !CPU_ISSET(id, &allowed))) {
+      continue;
+    }
+    std::string topology =
+        sysfsRoot + "/cpu/cpu" + std::to_string(id) + "/topology/";
+    Cpu cpu;
+    cpu.id = id;
+    cpu.core = readInt(topology + "core_id", id);
+    cpu.package = readInt(topology + "physical_package_id", 0);
+    auto it = nodeOfCpu.find(id);
+    cpu.node = it == nodeOfCpu.end() ? 0 : it->second;
+    cpus_.push_back(cpu);
+  }
+}
+
+int CpuTopology::nodeOf(int cpu) const {
+  for (const Cpu &c : cpus_) {
+    if (c.id == cpu) {
+      return c.node;
+    }
+  }
+  return -1;
+}
+
+std::vector<int> CpuTopology::spreadOrder() const {
+  // 按节点分组，组内每个物理核的第一个逻辑 CPU 在前，超线程在后
+  std::vector<std::vector<int>> firsts(numNodes_);
+  std::vector<std::vector<int>> siblings(numNodes_);
+  std::map<std::pair<int, int>, bool> seenCores;
+  for (const Cpu &c : cpus_) {
+    std::pair<int, int> core(c.package, c.core);
+    if (seenCores.count(core)) {
+      siblings[c.node].push_back(c.id);
+    } else {
+      seenCores[core] = true;
+      firsts[c.node].push_back(c.id);
+    }
+  }
+
+  std::vector<int> order;
+  for (std::vector<std::vector<int>> *groups : {&firsts, &siblings}) {
+    size_t longest = 0;
+    for (const std::vector<int> &group : *groups) {
+      longest = std::max(longest, group.size());
+    }
+    for (size_t i = 0; i < longest; ++i) {
+      for (const std::vector<int> &group : *groups) {
+        if (i < group.size()) {
+          order.push_back(group[i]);
+        }
+      }
+    }
+  }
+  return order;
+}
+
+std::vector<int> CpuTopology::parseCpuList(const std::string &list) {
+  std::vector<int> cpus;
+  const char *p = list.c_str();
+  while (*p) {
+    char *end = nullptr;
+    long first = ::strtol(p, &end, 10);
+    if (end == p) {
+      break;
+    }
+    long last = first;
+    p = end;
+    if (*p == '-') {
+      last = ::strtol(p + 1, &end, 10);
+      if (end == p + 1) {
+        break;
+      }
+      p = end;
+    }
+    for (long cpu = first; cpu <= last; ++cpu) {
+      cpus.push_back(static_cast<int>(cpu));
+    }
+    while (*p == ',' || *p == ' ' || *p == '\n') {
+      ++p;
+    }
+  }
+  return cpus;
+}
+
+bool CpuTopology::bindCurrentThread(const std::vector<int> &cpus) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int cpu : cpus) {
+    if (cpu >= 0 && cpu < CPU_SETSIZE) {
+      CPU_SET(cpu, &set);
+    }
+  }
+  if (CPU_COUNT(&set) == 0) {
+    return false;
+  }
+  return ::sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+
+bool CpuTopology::preferNode(int node) {
+#ifdef SYS_set_mempolicy
+  static const int kMpolPreferred = 1;
+  static const int kBitsPerLong = 8 * sizeof(unsigned long);
+  if (node < 0 || node >= 64 * kBitsPerLong) {
+    return false;
+  }
+  unsigned long mask[64] = {0};
+  mask[node / kBitsPerLong] = 1UL << (node % kBitsPerLong);
+  return ::syscall(SYS_set_mempolicy, kMpolPreferred, mask,
+                   static_cast<unsigned long>(64 * kBitsPerLong)) == 0;
+#else
+  (void)node;
+  return false;
+#endif
+}
\ No newline at end of file
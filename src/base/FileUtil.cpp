@@ -1,20 +1,55 @@
 #include "include/FileUtil.h"
 
 #include <assert.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+
+#include <vector>
 
 #include "include/Logging.h"
 
 using namespace TinyWeb::base;
 
-FileUtil::FileUtil(std::string& fileName)
-    : fp_(::fopen(fileName.c_str(), "ae")), writtenBytes_(0) {
-  assert(fp_);
-  ::setbuffer(fp_, buffer_, sizeof(buffer_));
+FileUtil::FileUtil(std::string& fileName, const FileOptions& options)
+    : options_(options),
+      fp_(nullptr),
+      fd_(-1),
+      writtenBytes_(0),
+      startOffset_(0),
+      allocatedEnd_(0),
+      syncedEnd_(0) {
+  if (options_.directWrite) {
+    fd_ = ::open(fileName.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC,
+                 0644);
+    assert(fd_ >= 0);
+    startOffset_ = ::lseek(fd_, 0, SEEK_END);
+    allocatedEnd_ = syncedEnd_ = startOffset_;
+  } else {
+    fp_ = ::fopen(fileName.c_str(), "ae");
+    assert(fp_);
+    ::setbuffer(fp_, buffer_, sizeof(buffer_));
+  }
 }
 
-FileUtil::~FileUtil() { ::fclose(fp_); }
+FileUtil::~FileUtil() {
+  if (fp_) {
+    ::fclose(fp_);
+  } else {
+    releasePreallocated();
+    ::close(fd_);
+  }
+}
 
 void FileUtil::append(const char* data, size_t len) {
+  if (fd_ >= 0) {
+    struct iovec iov;
+    iov.iov_base = const_cast<char*>(data);
+    iov.iov_len = len;
+    appendDirect(&iov, 1);
+    return;
+  }
+
   size_t written = 0;
 
   while (written != len) {
@@ -32,8 +67,90 @@ void FileUtil::append(const char* data, size_t len) {
   writtenBytes_ += written;
 }
 
-void FileUtil::flush() { ::fflush(fp_); }
+void FileUtil::append(const struct iovec* iov, int iovcnt) {
+  if (fd_ >= 0) {
+    std::vector<struct iovec> vec(iov, iov + iovcnt);
+    appendDirect(vec.data(), iovcnt);
+    return;
+  }
+
+  for (int i = 0; i < iovcnt; ++i) {
+    append(static_cast<const char*>(iov[i].iov_base), iov[i].iov_len);
+  }
+}
+
+void FileUtil::flush() {
+  if (fp_) {
+    ::fflush(fp_);
+  }
+}
 
 size_t FileUtil::write(const char* data, size_t len) {
   return ::fwrite_unlocked(data, 1, len, fp_);
+}
+
+void FileUtil::appendDirect(struct iovec* iov, int iovcnt) {
+  if (options_.preallocateBytes > 0) {
+    off_t end = startOffset_ + writtenBytes_;
+    for (int i = 0; i < iovcnt; ++i) {
+      end += iov[i].iov_len;
+    }
+    // KEEP_SIZE 只预留磁盘空间，不改变文件长度
+    while (end > allocatedEnd_) {
+      if (::fallocate(fd_, FALLOC_FL_KEEP_SIZE, allocatedEnd_,
+                      options_.preallocateBytes) < 0) {
+        break;
+      }
+      allocatedEnd_ += options_.preallocateBytes;
+    }
+  }
+
+  while (iovcnt > 0) {
+    ssize_t n = ::writev(fd_, iov, iovcnt < IOV_MAX ? iovcnt : IOV_MAX);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      fprintf(stderr, "FileUtil::append() failed %s\n", getErrnoMsg(errno));
+      break;
+    }
+    writtenBytes_ += n;
+
+    // 跳过已完整写出的 iovec，处理部分写
+    while (iovcnt > 0 && static_cast<size_t>(n) >= iov->iov_len) {
+      n -= iov->iov_len;
+      ++iov;
+      --iovcnt;
+    }
+    if (iovcnt > 0) {
+      iov->iov_base = static_cast<char*>(iov->iov_base) + n;
+      iov->iov_len -= n;
+    }
+  }
+
+  afterDirectWrite();
+}
+
+void FileUtil::releasePreallocated() {
+  off_t end = startOffset_ + writtenBytes_;
+  if (allocatedEnd_ <= end) {
+    return;
+  }
+  // KEEP_SIZE 预留的块在文件长度之外，打洞会被截到文件长度而无效，
+  // 截断到已写入的长度才能归还
+  if (::ftruncate(fd_, end) < 0) {
+    fprintf(stderr, "FileUtil::releasePreallocated() failed %s\n",
+            getErrnoMsg(errno));
+  }
+  allocatedEnd_ = end;
+}
+
+void FileUtil::afterDirectWrite() {
+  off_t end = startOffset_ + writtenBytes_;
+  if (options_.syncRangeBytes > 0 &&
+      end - syncedEnd_ >= options_.syncRangeBytes) {
+    ::sync_file_range(fd_, syncedEnd_, end - syncedEnd_,
+                      SYNC_FILE_RANGE_WRITE);
+    syncedEnd_ = end;
+  }
 }
\ No newline at end of file
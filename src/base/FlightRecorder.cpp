@@ -0,0 +1,134 @@
+#include "include/FlightRecorder.h"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include <atomic>
+
+using namespace TinyWeb::base;
+
+namespace {
+// seq 为 0 表示正在写入，否则为写入序号 + 1，读者据此判断记录是否完整
+struct Record {
+  std::atomic<uint64_t> seq;
+  int len;
+  char data[FlightRecorder::kRecordSize];
+};
+
+Record* g_records = nullptr;
+size_t g_mask = 0;
+std::atomic<uint64_t> g_head(0);
+std::atomic<bool> g_dumped(false);
+char g_dumpPath[256];
+
+const int kFatalSignals[] = {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT};
+
+void writeAll(int fd, const char* data, size_t len) {
+  while (len > 0) {
+    ssize_t n = ::write(fd, data, len);
+    if (n <= 0) {
+      return;
+    }
+    data += n;
+    len -= n;
+  }
+}
+
+void fatalSignalHandler(int sig) {
+  FlightRecorder::dump();
+  // SA_RESETHAND 已恢复默认处理，重新触发以保留原本的退出方式
+  ::raise(sig);
+}
+}  // namespace
+
+void FlightRecorder::enable(const std::string& dumpPath, size_t records,
+                            Logger::LogLevel level,
+                            bool installSignalHandlers) {
+  size_t capacity = 1;
+  while (capacity < records) {
+    capacity <<= 1;
+  }
+  g_records = new Record[capacity];
+  for (size_t i = 0; i < capacity; ++i) {
+    g_records[i].seq.store(0, std::memory_order_relaxed);
+  }
+  g_mask = capacity - 1;
+  snprintf(g_dumpPath, sizeof(g_dumpPath), "%s", dumpPath.c_str());
+
+  if (installSignalHandlers) {
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = fatalSignalHandler;
+    sa.sa_flags = SA_RESETHAND;
+    sigemptyset(&sa.sa_mask);
+    for (int sig : kFatalSignals) {
+      ::sigaction(sig, &sa, nullptr);
+    }
+  }
+
+  g_recordLevel = level;
+  if (level < TINYWEB_MIN_LOG_LEVEL) {
+    LOG_WARN << "FlightRecorder level " << level
+             << " is below TINYWEB_MIN_LOG_LEVEL " << TINYWEB_MIN_LOG_LEVEL
+             << ", lower levels are compiled out";
+  }
+}
+
+bool FlightRecorder::enabled() { return g_records != nullptr; }
+
+void FlightRecorder::record(const char* data, int len) {
+  if (g_records == nullptr) {
+    return;
+  }
+  uint64_t index = g_head.fetch_add(1, std::memory_order_relaxed);
+  Record& record = g_records[index & g_mask];
+
+  record.seq.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  if (len > kRecordSize) {
+    len = kRecordSize;
+    memcpy(record.data, data, len - 1);
+    record.data[len - 1] = '\n';
+  } else {
+    memcpy(record.data, data, len);
+  }
+  record.len = len;
+  record.seq.store(index + 1, std::memory_order_release);
+}
+
+void FlightRecorder::dump() {
+  if (g_records == nullptr || g_dumped.exchange(true)) {
+    return;
+  }
+  int fd = ::open(g_dumpPath, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    return;
+  }
+
+  static const char kHeader[] = "---- flight recorder ----\n";
+  writeAll(fd, kHeader, sizeof(kHeader) - 1);
+
+  uint64_t head = g_head.load(std::memory_order_acquire);
+  uint64_t begin = head > g_mask + 1 ? head - (g_mask + 1) : 0;
+  char buf[kRecordSize];
+  for (uint64_t index = begin; index < head; ++index) {
+    const Record& record = g_records[index & g_mask];
+    uint64_t seq = record.seq.load(std::memory_order_acquire);
+    if (seq != index + 1) {
+      continue;
+    }
+    int len = record.len;
+    if (len < 0 || len > kRecordSize) {
+      continue;
+    }
+    memcpy(buf, record.data, len);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (record.seq.load(std::memory_order_relaxed) != seq) {
+      continue;
+    }
+    writeAll(fd, buf, len);
+  }
+  ::fsync(fd);
+  ::close(fd);
+}
\ No newline at end of file
@@ -0,0 +1,69 @@
+#include "include/Histogram.h"
+
+#include <algorithm>
+#include <cstdio>
+
+using namespace TinyWeb::base;
+
+Histogram::Histogram() : count_(0), sum_(0), max_(0) {
+  for (std::atomic<uint64_t> &bucket : buckets_) {
+    bucket.store(0, std::memory_order_relaxed);
+  }
+}
+
+uint64_t Histogram::bucketLimit(int index) {
+  if (index < kSubBuckets) {
+    return static_cast<uint64_t>(index) + 1;
+  }
+  int shift = index / kSubBuckets - 1;
+  uint64_t sub = static_cast<uint64_t>(index % kSubBuckets) + kSubBuckets + 1;
+  // 最高的桶上界超出 64 位，取最大值
+  if (shift + kSubBucketBits + 1 >= 64 && sub == 2 * kSubBuckets) {
+    return UINT64_MAX;
+  }
+  return sub << shift;
+}
+
+Histogram::Snapshot Histogram::snapshot() const {
+  Snapshot snap;
+  snap.buckets.resize(kNumBuckets);
+  for (int i = 0; i < kNumBuckets; ++i) {
+    snap.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+  }
+  snap.count = count_.load(std::memory_order_relaxed);
+  snap.sum = sum_.load(std::memory_order_relaxed);
+  snap.max = max_.load(std::memory_order_relaxed);
+  return snap;
+}
+
+uint64_t Histogram::Snapshot::percentile(double p) const {
+  uint64_t total = 0;
+  for (uint64_t n : buckets) {
+    total += n;
+  }
+  if (total == 0) {
+    return 0;
+  }
+  uint64_t rank = static_cast<uint64_t>(p * (total - 1)) + 1;
+  uint64_t seen = 0;
+  for (size_t i = 0; i < buckets.size(); ++i) {
+    seen += buckets[i];
+    if (seen >= rank) {
+      uint64_t limit = bucketLimit(static_cast<int>(i));
+      return std::min(limit == UINT64_MAX ? limit : limit - 1, max);
+    }
+  }
+  return max;
+}
+
+std::string Histogram::Snapshot::toString() const {
+  char buf[160];
+  snprintf(buf, sizeof(buf),
+           "count=%llu mean=%.1f p50=%llu p99=%llu p999=%llu max=%llu",
+           static_cast<unsigned long long>(count), mean(),
+           static_cast<unsigned long long>(percentile(0.5)),
+           static_cast<unsigned long long>(percentile(0.99)),
+           static_cast<unsigned long long>(percentile(0.999)),
+           static_cast<unsigned long long>(max));
+  return buf;
+}
\ No newline at end of file
@@ -0,0 +1,132 @@
+#include "include/LogCompressor.h"
+
+#include <fcntl.h>
+#include <glob.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include "include/Logging.h"
+
+using namespace TinyWeb::base;
+
+// LogFile::getLogFileName 生成的 ".%Y%m%d-%H%M%S.log" 后缀长度
+static const size_t kLogSuffixLength = 20;
+
+LogCompressor::LogCompressor(int level, int retention)
+    : level_(level),
+      retention_(retention),
+      running_(false),
+      thread_(std::bind(&LogCompressor::threadFunc, this), "LogCompressor") {}
+
+LogCompressor::~LogCompressor() {
+  if (running_) {
+    stop();
+  }
+}
+
+void LogCompressor::start() {
+  running_ = true;
+  thread_.start();
+}
+
+void LogCompressor::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    running_ = false;
+  }
+  cond_.notify_one();
+  thread_.join();
+}
+
+void LogCompressor::compress(const std::string& filename) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    queue_.push_back(filename);
+  }
+  cond_.notify_one();
+}
+
+void LogCompressor::threadFunc() {
+  for (;;) {
+    std::string filename;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cond_.wait(lock, [this]() { return !queue_.empty() || !running_; });
+      if (queue_.empty()) {
+        break;
+      }
+      filename = queue_.front();
+      queue_.pop_front();
+    }
+
+    if (compressFile(filename) && retention_ > 0) {
+      removeOldFiles(filename);
+    }
+  }
+}
+
+bool LogCompressor::compressFile(const std::string& filename) {
+  int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    fprintf(stderr, "LogCompressor open %s failed %s\n", filename.c_str(),
+            getErrnoMsg(errno));
+    return false;
+  }
+
+  std::string gzname = filename + ".gz";
+  char mode[8];
+  snprintf(mode, sizeof(mode), "wb%d", level_);
+  gzFile gz = ::gzopen(gzname.c_str(), mode);
+  if (gz == nullptr) {
+    fprintf(stderr, "LogCompressor gzopen %s failed\n", gzname.c_str());
+    ::close(fd);
+    return false;
+  }
+
+  char buf[64 * 1024];
+  bool ok = true;
+  ssize_t n = 0;
+  while ((n = ::read(fd, buf, sizeof(buf))) > 0) {
+    if (::gzwrite(gz, buf, static_cast<unsigned>(n)) != n) {
+      ok = false;
+      break;
+    }
+  }
+  if (n < 0) {
+    ok = false;
+  }
+  ::close(fd);
+  if (::gzclose(gz) != Z_OK) {
+    ok = false;
+  }
+
+  // 压缩失败时保留原文件
+  if (ok) {
+    ::unlink(filename.c_str());
+  } else {
+    fprintf(stderr, "LogCompressor compress %s failed\n", filename.c_str());
+    ::unlink(gzname.c_str());
+  }
+  return ok;
+}
+
+void LogCompressor::removeOldFiles(const std::string& filename) {
+  if (filename.size() <= kLogSuffixLength) {
+    return;
+  }
+  // 只匹配时间戳本身，basename.loop3.<时间戳>.log.gz 这类分片归档不受影响
+  std::string pattern =
+      filename.substr(0, filename.size() - kLogSuffixLength) +
+      ".[0-9][0-9][0-9][0-9][0-9][0-9][0-9][0-9]-[0-9][0-9][0-9][0-9][0-9][0-9]"
+      ".log.gz";
+
+  glob_t result;
+  if (::glob(pattern.c_str(), 0, nullptr, &result) == 0) {
+    // glob 结果按文件名排序，文件名中的时间戳保证了从旧到新
+    size_t count = result.gl_pathc;
+    for (size_t i = 0; i + retention_ < count; ++i) {
+      ::unlink(result.gl_pathv[i]);
+    }
+  }
+  ::globfree(&result);
+}
\ No newline at end of file
@@ -3,11 +3,14 @@
 using namespace TinyWeb::base;
 
 LogFile::LogFile(const std::string& basename, off_t rollSize, int flushInterval,
-                 int checkEveryN)
+                 int checkEveryN, const HeaderFunc& header,
+                 const FileOptions& options)
     : basename_(basename),
       rollSize_(rollSize),
       flushInterval_(flushInterval),
       checkEveryN_(checkEveryN),
+      header_(header),
+      options_(options),
       count_(0),
       mutex_(new std::mutex),
       startOfPeriod_(0),
@@ -23,9 +26,18 @@ void LogFile::append(const char* data, int len) {
   appendInLock(data, len);
 }
 
+void LogFile::append(const struct iovec* iov, int iovcnt) {
+  std::lock_guard<std::mutex> lock(*mutex_);
+  file_->append(iov, iovcnt);
+  afterAppend();
+}
+
 void LogFile::appendInLock(const char* data, int len) {
   file_->append(data, len);
+  afterAppend();
+}
 
+void LogFile::afterAppend() {
   if (file_->writtenBytes() > rollSize_) {
     rollFile();
   } else {
@@ -55,7 +67,15 @@ bool LogFile::rollFile() {
     lastRoll_ = now;
     lastFlush_ = now;
     startOfPeriod_ = start;
-    file_.reset(new FileUtil(filename));
+    file_.reset(new FileUtil(filename, options_));
+    if (header_) {
+      std::string header = header_();
+      file_->append(header.data(), header.size());
+    }
+    filename_.swap(filename);
+    if (rollCallback_ && !filename.empty()) {
+      rollCallback_(filename);
+    }
     return true;
   }
   return false;
@@ -1,33 +1,15 @@
 #include "include/LogStream.h"
 
-#include <algorithm>
+#include "include/NumberFormat.h"
 
 using namespace TinyWeb::base;
 
-static const char digits[] = {'9', '8', '7', '6', '5', '4', '3', '2', '1', '0',
-                              '1', '2', '3', '4', '5', '6', '7', '8', '9'};
-
 template <typename T>
 void LogStream::formatInteger(T num) {
   if (buffer_.avail() >= kMaxNumericSize) {
-    char* start = buffer_.current();
-    char* cur = start;
-    const char* zero = digits + 9;
-    bool negative = (num < 0);
-
-    do {
-      int remainder = static_cast<int>(num % 10);
-      *(cur++) = zero[remainder];
-      num = num / 10;
-    } while (num != 0);
-
-    if (negative) {
-      *(cur++) = '-';
-    }
-    (*cur) = '\0';
-
-    std::reverse(start, cur);
-    buffer_.add(static_cast<int>(cur - start));
+    size_t len = num < 0 ? formatSigned(buffer_.current(), num)
+                         : formatUnsigned(buffer_.current(), num);
+    buffer_.add(len);
   }
 }
 
@@ -78,9 +60,7 @@ LogStream& LogStream::operator<<(float v) {
 
 LogStream& LogStream::operator<<(double v) {
   if (buffer_.avail() >= kMaxNumericSize) {
-    char buf[32];
-    int len = snprintf(buffer_.current(), kMaxNumericSize, "%.12g", v);
-    buffer_.add(len);
+    buffer_.add(formatDouble(buffer_.current(), v));
   }
   return *this;
 }
@@ -91,8 +71,7 @@ LogStream& LogStream::operator<<(char c) {
 }
 
 LogStream& LogStream::operator<<(const void* data) {
-  *this << static_cast<const char*>(data);
-  return *this;
+  return *this << Hex(reinterpret_cast<uintptr_t>(data));
 }
 
 LogStream& LogStream::operator<<(const char* str) {
@@ -121,4 +100,14 @@ LogStream& LogStream::operator<<(const Buffer& buf) {
 LogStream& LogStream::operator<<(const GeneralTemplate& g) {
   buffer_.append(g.data_, g.len_);
   return *this;
+}
+
+LogStream& LogStream::operator<<(const Hex& h) {
+  if (buffer_.avail() >= kMaxNumericSize) {
+    char* buf = buffer_.current();
+    buf[0] = '0';
+    buf[1] = 'x';
+    buffer_.add(2 + formatHex(buf + 2, h.value_));
+  }
+  return *this;
 }
\ No newline at end of file
@@ -1,9 +1,32 @@
 #include "include/Logging.h"
 
+#include "include/FlightRecorder.h"
+
+#include <time.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
 using namespace TinyWeb::base;
 
 namespace ThreadInfo {
 __thread char errnobuf[512];
+__thread char t_time[64];
+__thread time_t t_lastSecond = -1;
+
+// 时区偏移只在首次使用时计算一次
+long gmtOffset() {
+  static const long offset = []() {
+    time_t now = ::time(NULL);
+    struct tm tm_time;
+    ::localtime_r(&now, &tm_time);
+    return tm_time.tm_gmtoff;
+  }();
+  return offset;
+}
 }  // namespace ThreadInfo
 
 const char* TinyWeb::base::getErrnoMsg(int savedErrno) {
@@ -19,6 +42,63 @@ Logger::LogLevel initLogLevel() { return Logger::INFO; }
 
 Logger::LogLevel TinyWeb::base::g_logLevel = initLogLevel();
 
+Logger::LogLevel TinyWeb::base::g_recordLevel = Logger::LEVEL_COUNT;
+
+namespace {
+struct FileLevel {
+  FileLevel(const char* f, Logger::LogLevel l) : file(f), level(l) {}
+
+  const std::string file;
+  std::atomic<Logger::LogLevel> level;
+};
+
+// 记录每个已使用过的源文件及其覆盖规则，只在设置级别和调用点首次执行时加锁
+struct LevelRegistry {
+  std::mutex mutex;
+  std::vector<std::unique_ptr<FileLevel>> files;
+  std::vector<std::pair<std::string, Logger::LogLevel>> overrides;
+};
+
+LevelRegistry& levelRegistry() {
+  static LevelRegistry registry;
+  return registry;
+}
+
+// 文件名或路径中的任意一级目录名与 pattern 相同
+bool matchPattern(const std::string& file, const std::string& pattern) {
+  size_t pos = 0;
+  for (;;) {
+    size_t slash = file.find('/', pos);
+    size_t end = slash == std::string::npos ? file.size() : slash;
+    if (file.compare(pos, end - pos, pattern) == 0) {
+      return true;
+    }
+    if (slash == std::string::npos) {
+      return false;
+    }
+    pos = slash + 1;
+  }
+}
+
+Logger::LogLevel effectiveLevel(const LevelRegistry& registry,
+                                const std::string& file) {
+  for (auto it = registry.overrides.rbegin(); it != registry.overrides.rend();
+       ++it) {
+    if (matchPattern(file, it->first)) {
+      return it->second;
+    }
+  }
+  return g_logLevel;
+}
+
+void updateFileLevels(LevelRegistry& registry) {
+  for (const auto& f : registry.files) {
+    f->level.store(effectiveLevel(registry, f->file),
+                   std::memory_order_relaxed);
+  }
+}
+}  // namespace
+
 static void defaultOutput(const char* data, int len) {
   fwrite(data, len, sizeof(char), stdout);
 }
@@ -28,12 +108,14 @@ static void defaultFlush() { fflush(stdout); }
 Logger::OutputFunc g_output = defaultOutput;
 Logger::FlushFunc g_flush = defaultFlush;
 
-Logger::Impl::Impl(LogLevel level, int savedErrno, const char* file, int line)
+Logger::Impl::Impl(LogLevel level, int savedErrno, SourceFile file, int line,
+                   int sinks)
     : time_(Timestamp::now()),
       stream_(),
       level_(level),
       line_(line),
-      basename_(file) {
+      basename_(file),
+      sinks_(sinks) {
   formatTime();
   stream_ << GeneralTemplate(getLevelName[level], 6);
   if (savedErrno != 0) {
@@ -42,13 +124,31 @@ Logger::Impl::Impl(LogLevel level, int savedErrno, const char* file, int line)
 }
 
 void Logger::Impl::formatTime() {
-  Timestamp now = Timestamp::now();
-  int microseconds = static_cast<int>(now.microSecondsSinceEpoch() %
+  int64_t microSecondsSinceEpoch = time_.microSecondsSinceEpoch();
+  time_t seconds = static_cast<time_t>(microSecondsSinceEpoch /
+                                       Timestamp::kMicroSecondsPerSecond);
+  int microseconds = static_cast<int>(microSecondsSinceEpoch %
                                       Timestamp::kMicroSecondsPerSecond);
 
-  char buf[32] = {0};
-  snprintf(buf, sizeof(buf), "%06d ", microseconds);
-  stream_ << GeneralTemplate(now.toString().c_str(), 26) << ' ';
+  // 秒数变化时才重新生成 "YYYY/MM/DD HH:MM:SS" 前缀
+  if (seconds != ThreadInfo::t_lastSecond) {
+    ThreadInfo::t_lastSecond = seconds;
+    struct tm tm_time;
+    time_t localSeconds = seconds + ThreadInfo::gmtOffset();
+    ::gmtime_r(&localSeconds, &tm_time);
+    snprintf(ThreadInfo::t_time, sizeof(ThreadInfo::t_time),
+             "%4d/%02d/%02d %02d:%02d:%02d.", tm_time.tm_year + 1900,
+             tm_time.tm_mon + 1, tm_time.tm_mday, tm_time.tm_hour,
+             tm_time.tm_min, tm_time.tm_sec);
+  }
+
+  char* us = ThreadInfo::t_time + 20;
+  for (int i = 5; i >= 0; --i) {
+    us[i] = static_cast<char>('0' + microseconds % 10);
+    microseconds /= 10;
+  }
+  us[6] = ' ';
+  stream_ << GeneralTemplate(ThreadInfo::t_time, 27);
 }
 
 void Logger::Impl::finish() {
@@ -56,28 +156,88 @@ void Logger::Impl::finish() {
           << line_ << '\n';
 }
 
-Logger::Logger(const char* file, int line) : impl_(INFO, 0, file, line) {}
+Logger::Logger(SourceFile file, int line)
+    : impl_(INFO, 0, file, line, kOutput | sinks(LEVEL_COUNT, INFO)) {}
 
-Logger::Logger(const char* file, int line, Logger::LogLevel level)
-    : impl_(level, 0, file, line) {}
+Logger::Logger(SourceFile file, int line, Logger::LogLevel level)
+    : impl_(level, 0, file, line, kOutput | sinks(LEVEL_COUNT, level)) {}
 
-Logger::Logger(const char* file, int line, Logger::LogLevel level,
+Logger::Logger(SourceFile file, int line, Logger::LogLevel level,
                const char* func)
-    : impl_(level, 0, file, line) {
+    : impl_(level, 0, file, line, kOutput | sinks(LEVEL_COUNT, level)) {
   impl_.stream_ << func << ' ';
 }
 
+Logger::Logger(SourceFile file, int line, Logger::LogLevel level,
+               const char* func, int sinks)
+    : impl_(level, 0, file, line, sinks) {
+  if (func) {
+    impl_.stream_ << func << ' ';
+  }
+}
+
 Logger::~Logger() {
   impl_.finish();
   const LogStream::Buffer& buf(stream().buffer());
-  g_output(buf.data(), buf.length());
+  if (impl_.sinks_ & kRecord) {
+    FlightRecorder::record(buf.data(), buf.length());
+  }
+  if (impl_.sinks_ & kOutput) {
+    g_output(buf.data(), buf.length());
+  }
   if (impl_.level_ == FATAL) {
     g_flush();
+    FlightRecorder::dump();
     abort();
   }
 }
 
-void Logger::setLogLevel(Logger::LogLevel level) { g_logLevel = level; }
+void Logger::setLogLevel(Logger::LogLevel level) {
+  LevelRegistry& registry = levelRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  g_logLevel = level;
+  updateFileLevels(registry);
+}
+
+void Logger::setLogLevel(const char* pattern, Logger::LogLevel level) {
+  LevelRegistry& registry = levelRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  for (auto it = registry.overrides.begin(); it != registry.overrides.end();
+       ++it) {
+    if (it->first == pattern) {
+      registry.overrides.erase(it);
+      break;
+    }
+  }
+  registry.overrides.emplace_back(pattern, level);
+  updateFileLevels(registry);
+}
+
+void Logger::clearLogLevel(const char* pattern) {
+  LevelRegistry& registry = levelRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  for (auto it = registry.overrides.begin(); it != registry.overrides.end();
+       ++it) {
+    if (it->first == pattern) {
+      registry.overrides.erase(it);
+      break;
+    }
+  }
+  updateFileLevels(registry);
+}
+
+const std::atomic<Logger::LogLevel>& Logger::fileLogLevel(const char* file) {
+  LevelRegistry& registry = levelRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  for (const auto& f : registry.files) {
+    if (f->file == file) {
+      return f->level;
+    }
+  }
+  registry.files.emplace_back(
+      new FileLevel(file, effectiveLevel(registry, file)));
+  return registry.files.back()->level;
+}
 
 void Logger::setOutput(OutputFunc out) { g_output = out; }
 
@@ -0,0 +1,357 @@
+#include "include/NumberFormat.h"
+
+#include <string.h>
+
+using namespace TinyWeb::base;
+
+namespace {
+const char kDigitsLut[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+const char kHexDigits[] = "0123456789abcdef";
+
+// 10^-348 到 10^340，步长为 8 的 64 位规格化近似值
+const uint64_t kCachedPowersF[] = {
+    0xfa8fd5a0081c0288ULL, 0xbaaee17fa23ebf76ULL, 0x8b16fb203055ac76ULL,
+    0xcf42894a5dce35eaULL, 0x9a6bb0aa55653b2dULL, 0xe61acf033d1a45dfULL,
+    0xab70fe17c79ac6caULL, 0xff77b1fcbebcdc4fULL, 0xbe5691ef416bd60cULL,
+    0x8dd01fad907ffc3cULL, 0xd3515c2831559a83ULL, 0x9d71ac8fada6c9b5ULL,
+    0xea9c227723ee8bcbULL, 0xaecc49914078536dULL, 0x823c12795db6ce57ULL,
+    0xc21094364dfb5637ULL, 0x9096ea6f3848984fULL, 0xd77485cb25823ac7ULL,
+    0xa086cfcd97bf97f4ULL, 0xef340a98172aace5ULL, 0xb23867fb2a35b28eULL,
+    0x84c8d4dfd2c63f3bULL, 0xc5dd44271ad3cdbaULL, 0x936b9fcebb25c996ULL,
+    0xdbac6c247d62a584ULL, 0xa3ab66580d5fdaf6ULL, 0xf3e2f893dec3f126ULL,
+    0xb5b5ada8aaff80b8ULL, 0x87625f056c7c4a8bULL, 0xc9bcff6034c13053ULL,
+    0x964e858c91ba2655ULL, 0xdff9772470297ebdULL, 0xa6dfbd9fb8e5b88fULL,
+    0xf8a95fcf88747d94ULL, 0xb94470938fa89bcfULL, 0x8a08f0f8bf0f156bULL,
+    0xcdb02555653131b6ULL, 0x993fe2c6d07b7facULL, 0xe45c10c42a2b3b06ULL,
+    0xaa242499697392d3ULL, 0xfd87b5f28300ca0eULL, 0xbce5086492111aebULL,
+    0x8cbccc096f5088ccULL, 0xd1b71758e219652cULL, 0x9c40000000000000ULL,
+    0xe8d4a51000000000ULL, 0xad78ebc5ac620000ULL, 0x813f3978f8940984ULL,
+    0xc097ce7bc90715b3ULL, 0x8f7e32ce7bea5c70ULL, 0xd5d238a4abe98068ULL,
+    0x9f4f2726179a2245ULL, 0xed63a231d4c4fb27ULL, 0xb0de65388cc8ada8ULL,
+    0x83c7088e1aab65dbULL, 0xc45d1df942711d9aULL, 0x924d692ca61be758ULL,
+    0xda01ee641a708deaULL, 0xa26da3999aef774aULL, 0xf209787bb47d6b85ULL,
+    0xb454e4a179dd1877ULL, 0x865b86925b9bc5c2ULL, 0xc83553c5c8965d3dULL,
+    0x952ab45cfa97a0b3ULL, 0xde469fbd99a05fe3ULL, 0xa59bc234db398c25ULL,
+    0xf6c69a72a3989f5cULL, 0xb7dcbf5354e9beceULL, 0x88fcf317f22241e2ULL,
+    0xcc20ce9bd35c78a5ULL, 0x98165af37b2153dfULL, 0xe2a0b5dc971f303aULL,
+    0xa8d9d1535ce3b396ULL, 0xfb9b7cd9a4a7443cULL, 0xbb764c4ca7a44410ULL,
+    0x8bab8eefb6409c1aULL, 0xd01fef10a657842cULL, 0x9b10a4e5e9913129ULL,
+    0xe7109bfba19c0c9dULL, 0xac2820d9623bf429ULL, 0x80444b5e7aa7cf85ULL,
+    0xbf21e44003acdd2dULL, 0x8e679c2f5e44ff8fULL, 0xd433179d9c8cb841ULL,
+    0x9e19db92b4e31ba9ULL, 0xeb96bf6ebadf77d9ULL, 0xaf87023b9bf0ee6bULL,
+};
+
+const int16_t kCachedPowersE[] = {
+    -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980,
+    -954, -927, -901, -874, -847, -821, -794, -768, -741, -715,
+    -688, -661, -635, -608, -582, -555, -529, -502, -475, -449,
+    -422, -396, -369, -343, -316, -289, -263, -236, -210, -183,
+    -157, -130, -103, -77, -50, -24, 3, 30, 56, 83,
+    109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+    375, 402, 428, 455, 481, 508, 534, 561, 588, 614,
+    641, 667, 694, 720, 747, 774, 800, 827, 853, 880,
+    907, 933, 960, 986, 1013, 1039, 1066,
+};
+
+const uint64_t kPow10[] = {1ULL,
+                           10ULL,
+                           100ULL,
+                           1000ULL,
+                           10000ULL,
+                           100000ULL,
+                           1000000ULL,
+                           10000000ULL,
+                           100000000ULL,
+                           1000000000ULL,
+                           10000000000ULL,
+                           100000000000ULL,
+                           1000000000000ULL,
+                           10000000000000ULL,
+                           100000000000000ULL,
+                           1000000000000000ULL,
+                           10000000000000000ULL,
+                           100000000000000000ULL,
+                           1000000000000000000ULL,
+                           10000000000000000000ULL};
+
+struct DiyFp {
+  DiyFp() : f(0), e(0) {}
+  DiyFp(uint64_t fp, int exp) : f(fp), e(exp) {}
+
+  explicit DiyFp(double d) {
+    uint64_t u;
+    memcpy(&u, &d, sizeof(u));
+    int biasedE = static_cast<int>((u & kExponentMask) >> kSignificandSize);
+    uint64_t significand = u & kSignificandMask;
+    if (biasedE != 0) {
+      f = significand + kHiddenBit;
+      e = biasedE - kExponentBias;
+    } else {
+      f = significand;
+      e = kMinExponent + 1;
+    }
+  }
+
+  DiyFp operator-(const DiyFp& rhs) const { return DiyFp(f - rhs.f, e); }
+
+  DiyFp operator*(const DiyFp& rhs) const {
+    const uint64_t M32 = 0xFFFFFFFFULL;
+    const uint64_t a = f >> 32;
+    const uint64_t b = f & M32;
+    const uint64_t c = rhs.f >> 32;
+    const uint64_t d = rhs.f & M32;
+    const uint64_t ac = a * c;
+    const uint64_t bc = b * c;
+    const uint64_t ad = a * d;
+    const uint64_t bd = b * d;
+    uint64_t tmp = (bd >> 32) + (ad & M32) + (bc & M32);
+    tmp += 1ULL << 31;
+    return DiyFp(ac + (ad >> 32) + (bc >> 32) + (tmp >> 32), e + rhs.e + 64);
+  }
+
+  DiyFp normalize() const {
+    int s = __builtin_clzll(f);
+    return DiyFp(f << s, e - s);
+  }
+
+  void normalizedBoundaries(DiyFp* minus, DiyFp* plus) const {
+    DiyFp pl = DiyFp((f << 1) + 1, e - 1).normalize();
+    DiyFp mi = (f == kHiddenBit) ? DiyFp((f << 2) - 1, e - 2)
+                                 : DiyFp((f << 1) - 1, e - 1);
+    mi.f <<= mi.e - pl.e;
+    mi.e = pl.e;
+    *plus = pl;
+    *minus = mi;
+  }
+
+  static const int kSignificandSize = 52;
+  static const int kExponentBias = 0x3FF + kSignificandSize;
+  static const int kMinExponent = -kExponentBias;
+  static const uint64_t kExponentMask = 0x7FF0000000000000ULL;
+  static const uint64_t kSignificandMask = 0x000FFFFFFFFFFFFFULL;
+  static const uint64_t kHiddenBit = 0x0010000000000000ULL;
+
+  uint64_t f;
+  int e;
+};
+
+DiyFp getCachedPower(int e, int* K) {
+  double dk = (-61 - e) * 0.30102999566398114 + 347;
+  int k = static_cast<int>(dk);
+  if (dk - k > 0.0) {
+    k++;
+  }
+  unsigned index = static_cast<unsigned>((k >> 3) + 1);
+  *K = -(-348 + static_cast<int>(index << 3));
+  return DiyFp(kCachedPowersF[index], kCachedPowersE[index]);
+}
+
+void grisuRound(char* buffer, int len, uint64_t delta, uint64_t rest,
+                uint64_t tenKappa, uint64_t wpW) {
+  while (rest < wpW && delta - rest >= tenKappa &&
+         (rest + tenKappa < wpW || wpW - rest > rest + tenKappa - wpW)) {
+    buffer[len - 1]--;
+    rest += tenKappa;
+  }
+}
+
+int countDecimalDigit32(uint32_t n) {
+  int count = 1;
+  while (n >= 10) {
+    n /= 10;
+    ++count;
+  }
+  return count;
+}
+
+void digitGen(const DiyFp& W, const DiyFp& Mp, uint64_t delta, char* buffer,
+              int* len, int* K) {
+  const DiyFp one(1ULL << -Mp.e, Mp.e);
+  const DiyFp wpW = Mp - W;
+  uint32_t p1 = static_cast<uint32_t>(Mp.f >> -one.e);
+  uint64_t p2 = Mp.f & (one.f - 1);
+  int kappa = countDecimalDigit32(p1);
+  *len = 0;
+
+  while (kappa > 0) {
+    uint32_t pow10 = static_cast<uint32_t>(kPow10[kappa - 1]);
+    uint32_t d = p1 / pow10;
+    p1 %= pow10;
+    if (d || *len) {
+      buffer[(*len)++] = static_cast<char>('0' + d);
+    }
+    kappa--;
+    uint64_t tmp = (static_cast<uint64_t>(p1) << -one.e) + p2;
+    if (tmp <= delta) {
+      *K += kappa;
+      grisuRound(buffer, *len, delta, tmp, kPow10[kappa] << -one.e, wpW.f);
+      return;
+    }
+  }
+
+  for (;;) {
+    p2 *= 10;
+    delta *= 10;
+    char d = static_cast<char>(p2 >> -one.e);
+    if (d || *len) {
+      buffer[(*len)++] = static_cast<char>('0' + d);
+    }
+    p2 &= one.f - 1;
+    kappa--;
+    if (p2 < delta) {
+      *K += kappa;
+      int index = -kappa;
+      grisuRound(buffer, *len, delta, p2, one.f,
+                 wpW.f * (index < 20 ? kPow10[index] : 0));
+      return;
+    }
+  }
+}
+
+void grisu2(double value, char* buffer, int* length, int* K) {
+  const DiyFp v(value);
+  DiyFp wM, wP;
+  v.normalizedBoundaries(&wM, &wP);
+
+  const DiyFp cMk = getCachedPower(wP.e, K);
+  const DiyFp W = v.normalize() * cMk;
+  DiyFp Wp = wP * cMk;
+  DiyFp Wm = wM * cMk;
+  Wm.f++;
+  Wp.f--;
+  digitGen(W, Wp, Wp.f - Wm.f, buffer, length, K);
+}
+
+char* writeExponent(int k, char* buf) {
+  *buf++ = 'e';
+  if (k < 0) {
+    *buf++ = '-';
+    k = -k;
+  } else {
+    *buf++ = '+';
+  }
+  if (k >= 100) {
+    *buf++ = static_cast<char>('0' + k / 100);
+    k %= 100;
+  }
+  memcpy(buf, kDigitsLut + k * 2, 2);
+  return buf + 2;
+}
+
+// digits 为 length 位有效数字，值为 digits * 10^k
+char* prettify(char* buf, int length, int k) {
+  const int kk = length + k;
+
+  if (0 <= k && kk <= 17) {
+    for (int i = length; i < kk; i++) {
+      buf[i] = '0';
+    }
+    return buf + kk;
+  } else if (0 < kk && kk <= 17) {
+    memmove(buf + kk + 1, buf + kk, length - kk);
+    buf[kk] = '.';
+    return buf + length + 1;
+  } else if (-4 < kk && kk <= 0) {
+    const int offset = 2 - kk;
+    memmove(buf + offset, buf, length);
+    buf[0] = '0';
+    buf[1] = '.';
+    for (int i = 2; i < offset; i++) {
+      buf[i] = '0';
+    }
+    return buf + length + offset;
+  } else if (length == 1) {
+    return writeExponent(kk - 1, buf + 1);
+  } else {
+    memmove(buf + 2, buf + 1, length - 1);
+    buf[1] = '.';
+    return writeExponent(kk - 1, buf + length + 1);
+  }
+}
+}  // namespace
+
+size_t TinyWeb::base::formatUnsigned(char* buf, unsigned long long v) {
+  char temp[kMaxNumberFormatSize];
+  char* end = temp + sizeof(temp);
+  char* p = end;
+
+  while (v >= 100) {
+    const unsigned i = static_cast<unsigned>(v % 100) * 2;
+    v /= 100;
+    p -= 2;
+    memcpy(p, kDigitsLut + i, 2);
+  }
+  if (v >= 10) {
+    p -= 2;
+    memcpy(p, kDigitsLut + v * 2, 2);
+  } else {
+    *--p = static_cast<char>('0' + v);
+  }
+
+  size_t len = static_cast<size_t>(end - p);
+  memcpy(buf, p, len);
+  return len;
+}
+
+size_t TinyWeb::base::formatSigned(char* buf, long long v) {
+  if (v < 0) {
+    *buf = '-';
+    return 1 + formatUnsigned(buf + 1, 0ULL - static_cast<unsigned long long>(v));
+  }
+  return formatUnsigned(buf, static_cast<unsigned long long>(v));
+}
+
+size_t TinyWeb::base::formatHex(char* buf, unsigned long long v) {
+  char temp[kMaxNumberFormatSize];
+  char* end = temp + sizeof(temp);
+  char* p = end;
+
+  do {
+    *--p = kHexDigits[v & 0xf];
+    v >>= 4;
+  } while (v != 0);
+
+  size_t len = static_cast<size_t>(end - p);
+  memcpy(buf, p, len);
+  return len;
+}
+
+size_t TinyWeb::base::formatDouble(char* buf, double v) {
+  uint64_t u;
+  memcpy(&u, &v, sizeof(u));
+  char* p = buf;
+  if (u >> 63) {
+    *p++ = '-';
+    v = -v;
+  }
+
+  if ((u & DiyFp::kExponentMask) == DiyFp::kExponentMask) {
+    if (u & DiyFp::kSignificandMask) {
+      memcpy(buf, "nan", 3);
+      return 3;
+    }
+    memcpy(p, "inf", 3);
+    return static_cast<size_t>(p + 3 - buf);
+  }
+
+  if (v == 0.0) {
+    *p++ = '0';
+    return static_cast<size_t>(p - buf);
+  }
+
+  int length = 0;
+  int K = 0;
+  grisu2(v, p, &length, &K);
+  return static_cast<size_t>(prettify(p, length, K) - buf);
+}
@@ -0,0 +1,58 @@
+#include "include/ShardedLogging.h"
+
+using namespace TinyWeb::base;
+
+std::atomic<uint64_t> ShardedLogging::numCreated_(0);
+
+namespace {
+// 当前线程绑定的 ShardedLogging 实例 id 与分片
+thread_local uint64_t t_owner = 0;
+thread_local LogFile* t_shard = nullptr;
+}  // namespace
+
+ShardedLogging::ShardedLogging(const std::string& basename, off_t rollSize,
+                               int flushInterval)
+    : basename_(basename),
+      rollSize_(rollSize),
+      flushInterval_(flushInterval),
+      id_(++numCreated_),
+      fallback_(basename, rollSize, flushInterval) {}
+
+ShardedLogging::~ShardedLogging() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const std::unique_ptr<LogFile>& shard : shards_) {
+    shard->flush();
+  }
+  fallback_.flush();
+}
+
+void ShardedLogging::attachThread(const std::string& shard) {
+  LogFile* file =
+      new LogFile(basename_ + "." + shard, rollSize_, flushInterval_);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shards_.emplace_back(file);
+  }
+  t_shard = file;
+  t_owner = id_;
+}
+
+LogFile* ShardedLogging::localShard() const {
+  return t_owner == id_ ? t_shard : nullptr;
+}
+
+void ShardedLogging::append(const char* logline, int len) {
+  LogFile* shard = localShard();
+  if (shard) {
+    shard->append(logline, len);
+  } else {
+    fallback_.append(logline, len);
+  }
+}
+
+void ShardedLogging::flush() {
+  LogFile* shard = localShard();
+  if (shard) {
+    shard->flush();
+  }
+}
\ No newline at end of file
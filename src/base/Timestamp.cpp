@@ -3,22 +3,170 @@
 #include <sys/time.h>
 #include <time.h>
 
+#include <atomic>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#define TINYWEB_HAVE_TSC 1
+#endif
+
 using namespace TinyWeb::base;
 
-Timestamp Timestamp::now() {
+namespace {
+// 校准后 墙上时间微秒 = wallBase + (rdtsc - tscBase) * microsPerTick。
+// NTP 会调整系统时钟的频率而 TSC 不受影响，每隔 kResyncMicros 用
+// clock_gettime 重新对齐一次，偏差不超过该间隔内的频率误差。
+// 各字段由 seq 保护（seqlock），奇数表示正在更新
+struct TscClock {
+  std::atomic<bool> enabled{false};
+  std::atomic<uint32_t> seq{0};
+  std::atomic<uint64_t> tscBase{0};
+  std::atomic<int64_t> wallBase{0};
+  std::atomic<int64_t> monotonicBase{0};
+  std::atomic<double> microsPerTick{0};
+};
+
+const int64_t kResyncMicros = 1000 * 1000;
+
+TscClock g_tsc;
+
+int64_t systemMonotonicNanos() {
+  struct timespec ts;
+  ::clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+int64_t systemMonotonic() { return systemMonotonicNanos() / 1000; }
+
+int64_t systemNow() {
   struct timeval tv;
   gettimeofday(&tv, NULL);
-  return Timestamp(tv.tv_sec * kMicroSecondsPerSecond + tv.tv_usec);
+  return tv.tv_sec * Timestamp::kMicroSecondsPerSecond + tv.tv_usec;
+}
+
+#ifdef TINYWEB_HAVE_TSC
+// 用前后两次 rdtsc 夹住 clock_gettime，取区间最窄的一次的中点，单位 ns
+void sampleClocks(int64_t* monotonic, uint64_t* tsc) {
+  uint64_t best = UINT64_MAX;
+  for (int i = 0; i < 5; ++i) {
+    uint64_t before = __rdtsc();
+    int64_t now = systemMonotonicNanos();
+    uint64_t after = __rdtsc();
+    if (after - before < best) {
+      best = after - before;
+      *monotonic = now;
+      *tsc = before + (after - before) / 2;
+    }
+  }
+}
+
+// 以当前的系统时钟为新的基准，并用上一次基准以来的区间修正频率。
+// 只有抢到 seq 的一个线程执行，其他线程继续使用旧的基准
+void resyncTsc(uint32_t seq) {
+  if (!g_tsc.seq.compare_exchange_strong(seq, seq + 1,
+                                         std::memory_order_acquire)) {
+    return;
+  }
+  int64_t monotonic = 0;
+  uint64_t tsc = 0;
+  sampleClocks(&monotonic, &tsc);
+  int64_t wall = systemNow() - (systemMonotonic() - monotonic / 1000);
+  uint64_t tscBase = g_tsc.tscBase.load(std::memory_order_relaxed);
+  int64_t monotonicBase = g_tsc.monotonicBase.load(std::memory_order_relaxed);
+  if (tsc > tscBase && monotonic / 1000 > monotonicBase) {
+    g_tsc.microsPerTick.store(
+        static_cast<double>(monotonic / 1000 - monotonicBase) /
+            static_cast<double>(tsc - tscBase),
+        std::memory_order_relaxed);
+  }
+  g_tsc.tscBase.store(tsc, std::memory_order_relaxed);
+  g_tsc.monotonicBase.store(monotonic / 1000, std::memory_order_relaxed);
+  g_tsc.wallBase.store(wall, std::memory_order_relaxed);
+  g_tsc.seq.store(seq + 2, std::memory_order_release);
+}
+
+int64_t tscNow() {
+  for (;;) {
+    uint32_t seq = g_tsc.seq.load(std::memory_order_acquire);
+    if (seq & 1) {
+      return systemNow();
+    }
+    uint64_t tscBase = g_tsc.tscBase.load(std::memory_order_relaxed);
+    int64_t wallBase = g_tsc.wallBase.load(std::memory_order_relaxed);
+    double microsPerTick = g_tsc.microsPerTick.load(std::memory_order_relaxed);
+    uint64_t tsc = __rdtsc();
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (g_tsc.seq.load(std::memory_order_relaxed) != seq) {
+      continue;
+    }
+    int64_t elapsed = static_cast<int64_t>(
+        static_cast<double>(tsc - tscBase) * microsPerTick);
+    if (tsc < tscBase || elapsed > kResyncMicros) {
+      resyncTsc(seq);
+      return systemNow();
+    }
+    return wallBase + elapsed;
+  }
+}
+#endif
+}  // namespace
+
+Timestamp Timestamp::now() {
+#ifdef TINYWEB_HAVE_TSC
+  if (g_tsc.enabled.load(std::memory_order_relaxed)) {
+    return Timestamp(tscNow());
+  }
+#endif
+  return Timestamp(systemNow());
+}
+
+// 定时器和 timerfd 依赖它与内核的 CLOCK_MONOTONIC 严格一致，
+// 不使用 TSC；clock_gettime 走 vDSO，开销本来就很小
+Timestamp Timestamp::monotonic() { return Timestamp(systemMonotonic()); }
+
+bool Timestamp::useTscClock(int calibrateMs) {
+#ifdef TINYWEB_HAVE_TSC
+  // CPUID.80000007H:EDX[8] 表示 TSC 频率恒定且不随 C-state 停止
+  unsigned int eax, ebx, ecx, edx;
+  if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) ||
+      !(edx & (1u << 8))) {
+    return false;
+  }
+
+  int64_t monotonic0 = 0, monotonic1 = 0;
+  uint64_t tsc0 = 0, tsc1 = 0;
+  sampleClocks(&monotonic0, &tsc0);
+  struct timespec ts = {calibrateMs / 1000, (calibrateMs % 1000) * 1000000L};
+  ::nanosleep(&ts, NULL);
+  sampleClocks(&monotonic1, &tsc1);
+  int64_t wall1 = systemNow() - (systemMonotonic() - monotonic1 / 1000);
+  if (tsc1 <= tsc0 || monotonic1 <= monotonic0) {
+    return false;
+  }
+
+  g_tsc.microsPerTick = static_cast<double>(monotonic1 - monotonic0) / 1000 /
+                        static_cast<double>(tsc1 - tsc0);
+  g_tsc.tscBase = tsc1;
+  g_tsc.monotonicBase = monotonic1 / 1000;
+  g_tsc.wallBase = wall1;
+  g_tsc.enabled.store(true, std::memory_order_release);
+  return true;
+#else
+  (void)calibrateMs;
+  return false;
+#endif
 }
 
 std::string Timestamp::toString() const {
   char buf[128] = {0};
   time_t secondSinceEpoch = microSecondsSinceEpoch_ / kMicroSecondsPerSecond;
   int microSecondsSinceEpoch = microSecondsSinceEpoch_ % kMicroSecondsPerSecond;
-  tm *tm_time = localtime(&secondSinceEpoch);
+  tm tm_time;
+  localtime_r(&secondSinceEpoch, &tm_time);
   snprintf(buf, 128, "%4d/%02d/%02d %02d:%02d:%02d.%06d",
-           tm_time->tm_year + 1900, tm_time->tm_mon + 1, tm_time->tm_mday,
-           tm_time->tm_hour, tm_time->tm_min, tm_time->tm_sec,
+           tm_time.tm_year + 1900, tm_time.tm_mon + 1, tm_time.tm_mday,
+           tm_time.tm_hour, tm_time.tm_min, tm_time.tm_sec,
            microSecondsSinceEpoch);
   return buf;
 }
\ No newline at end of file
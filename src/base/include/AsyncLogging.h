@@ -3,20 +3,36 @@
 
 #include <atomic>
 #include <condition_variable>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <vector>
 
+#include "FileUtil.h"
 #include "FixedBuffer.h"
+#include "LogCompressor.h"
 #include "Thread.h"
 #include "noncopyable.h"
 
 namespace TinyWeb {
 namespace base {
+class LogFile;
+
 class AsyncLogging : noncopyable {
  public:
+  // kSharedBuffer: 所有线程竞争同一把锁写入 currentBuffer_
+  // kThreadLocalBuffer: 每个线程写入自己的缓冲区，后端线程负责收集
+  enum Mode { kSharedBuffer, kThreadLocalBuffer };
+
+  // 待写入的满缓冲区达到上限时的处理策略
+  // kUnbounded: 不设上限，按需分配新缓冲区
+  // kBlock: 阻塞生产者直到后端写出
+  // kDropNewest: 丢弃新到的日志
+  // kKeepOneInN: 过载期间每 N 条保留 1 条，仍放不下时丢弃
+  enum OverflowPolicy { kUnbounded, kBlock, kDropNewest, kKeepOneInN };
+
   AsyncLogging(const std::string& basename, off_t rollSize,
-               int flushInterval = 3);
+               int flushInterval = 3, Mode mode = kSharedBuffer);
   ~AsyncLogging() {
     if (running_) {
       stop();
@@ -24,16 +40,64 @@ class AsyncLogging : noncopyable {
   }
 
   void append(const char* logline, int len);
+  // 不受溢出策略影响，用于二进制日志的站点定义等不能丢失的记录
+  void appendCritical(const char* logline, int len);
 
   void start() {
+    if (compressor_) {
+      compressor_->start();
+    }
     running_ = true;
     thread_.start();
   }
 
   void stop() {
-    running_ = false;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      running_ = false;
+    }
     cond_.notify_one();
+    notFull_.notify_all();
     thread_.join();
+    if (compressor_) {
+      compressor_->stop();
+    }
+  }
+
+  Mode mode() const { return mode_; }
+
+  // 需在 start() 之前设置
+  void setOverflowPolicy(OverflowPolicy policy, size_t maxBuffers = 16,
+                         int sampleN = 100) {
+    overflowPolicy_ = policy;
+    maxBuffers_ = maxBuffers;
+    sampleN_ = sampleN > 0 ? sampleN : 1;
+  }
+
+  uint64_t droppedLines() const { return droppedLines_.load(); }
+  uint64_t droppedBytes() const { return droppedBytes_.load(); }
+
+  // 需在 start() 之前设置，例如 BinaryLogger::fileHeader
+  void setFileHeader(const std::function<std::string()>& header) {
+    fileHeader_ = header;
+  }
+
+  // 需在 start() 之前设置，例如 BinaryLogger::dropMarker
+  // 有日志被丢弃时，后端在写出缓冲区后追加该函数生成的记录
+  void setDropMarker(
+      const std::function<std::string(uint64_t lines, uint64_t bytes)>&
+          marker) {
+    dropMarker_ = marker;
+  }
+
+  // 需在 start() 之前设置
+  // directWrite 时每次唤醒收集到的缓冲区用一次 writev 写出
+  void setFileOptions(const FileOptions& options) { fileOptions_ = options; }
+
+  // 需在 start() 之前设置
+  // 滚动出的旧文件在后台压缩为 .gz，retention > 0 时只保留最近的若干个
+  void setCompression(int level, int retention = 0) {
+    compressor_.reset(new LogCompressor(level, retention));
   }
 
  private:
@@ -41,19 +105,69 @@ class AsyncLogging : noncopyable {
   using BufferVector = std::vector<std::unique_ptr<Buffer>>;
   using BufferPtr = BufferVector::value_type;
 
+  struct Stage {
+    std::thread::id tid;
+    std::mutex mutex;
+    BufferPtr current;
+    BufferPtr next;
+    BufferVector full;
+    int sampleCount = 0;
+  };
+  using StagePtr = std::shared_ptr<Stage>;
+
+  void appendShared(const char* logline, int len, bool critical);
+  void appendThreadLocal(const char* logline, int len, bool critical);
+  Stage* localStage();
+  size_t collectStages(BufferVector* buffersToWrite, BufferVector* spares);
+
+  bool overloaded(size_t pending) const {
+    return overflowPolicy_ != kUnbounded && pending >= maxBuffers_;
+  }
+  bool sampled(int* count) {
+    return overflowPolicy_ != kKeepOneInN || (*count)++ % sampleN_ == 0;
+  }
+  void dropLine(int len);
+  void waitNotFull();
+  void writeBuffers(LogFile* output, const BufferVector& buffers);
+  void writeDropMarker(LogFile* output);
+
   void threadFunc();
+  void threadFuncShared();
+  void threadFuncThreadLocal();
 
   const int flushInterval_;
   std::atomic_bool running_;
   const std::string basename_;
   const off_t rollSize_;
+  const Mode mode_;
+  const uint64_t id_;
+  std::function<std::string()> fileHeader_;
+  std::function<std::string(uint64_t, uint64_t)> dropMarker_;
+  FileOptions fileOptions_;
+  std::unique_ptr<LogCompressor> compressor_;
   Thread thread_;
   std::mutex mutex_;
   std::condition_variable cond_;
+  std::condition_variable notFull_;
 
   BufferPtr currentBuffer_;
   BufferPtr nextBuffer_;
   BufferVector buffers_;
+
+  std::vector<StagePtr> stages_;
+  bool stageFull_;
+  std::atomic<size_t> pendingBuffers_;
+
+  OverflowPolicy overflowPolicy_;
+  size_t maxBuffers_;
+  int sampleN_;
+  int sampleCount_;
+  std::atomic<uint64_t> droppedLines_;
+  std::atomic<uint64_t> droppedBytes_;
+  std::atomic<uint64_t> unreportedLines_;
+  std::atomic<uint64_t> unreportedBytes_;
+
+  static std::atomic<uint64_t> numCreated_;
 };
 }  // namespace base
 }  // namespace TinyWeb
@@ -0,0 +1,186 @@
+#ifndef SRC_BASE_INCLUDE_BINARYLOGGING_H_
+#define SRC_BASE_INCLUDE_BINARYLOGGING_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <unordered_map>
+
+#include "FixedBuffer.h"
+#include "LogStream.h"
+#include "Logging.h"
+#include "noncopyable.h"
+
+namespace TinyWeb {
+namespace base {
+// 日志调用点的静态描述，首次使用时分配 id
+struct LogSite : noncopyable {
+  LogSite(SourceFile file, int line, Logger::LogLevel level, const char* func)
+      : basename(file), line(line), level(level), func(func), id(0) {}
+
+  SourceFile basename;
+  const int line;
+  const Logger::LogLevel level;
+  const char* func;
+  std::atomic<uint32_t> id;
+};
+
+// 记录格式:
+//   文件头   "TWBLOG1\n" 后接当前已注册的全部 'S' 记录
+//   'S'     varint id, u8 level, varint line, varint len + file,
+//           varint len + func
+//   'R'     varint id, int64 微秒时间戳, u16 参数长度, 参数
+//   'D'     int64 微秒时间戳, varint 丢弃条数, varint 丢弃字节数
+// 参数为 类型标记 + 原始数据，整数使用 zigzag varint 编码
+class BinaryLogStream : noncopyable {
+ public:
+  using Buffer = FixedBuffer<kSmallBuffer>;
+
+  enum ArgType {
+    kSigned = 'i',
+    kUnsigned = 'u',
+    kDouble = 'd',
+    kHex = 'x',
+    kChar = 'c',
+    kString = 's',
+  };
+
+  const Buffer& buffer() const { return buffer_; }
+
+  BinaryLogStream& operator<<(bool v) { return *this << static_cast<int>(v); }
+  BinaryLogStream& operator<<(short v) {
+    return *this << static_cast<long long>(v);
+  }
+  BinaryLogStream& operator<<(unsigned short v) {
+    return *this << static_cast<unsigned long long>(v);
+  }
+  BinaryLogStream& operator<<(int v) {
+    return *this << static_cast<long long>(v);
+  }
+  BinaryLogStream& operator<<(unsigned int v) {
+    return *this << static_cast<unsigned long long>(v);
+  }
+  BinaryLogStream& operator<<(long v) {
+    return *this << static_cast<long long>(v);
+  }
+  BinaryLogStream& operator<<(unsigned long v) {
+    return *this << static_cast<unsigned long long>(v);
+  }
+  BinaryLogStream& operator<<(long long v);
+  BinaryLogStream& operator<<(unsigned long long v);
+
+  BinaryLogStream& operator<<(float v) {
+    return *this << static_cast<double>(v);
+  }
+  BinaryLogStream& operator<<(double v);
+
+  BinaryLogStream& operator<<(char c);
+  BinaryLogStream& operator<<(const void* data) {
+    return *this << Hex(reinterpret_cast<uintptr_t>(data));
+  }
+  BinaryLogStream& operator<<(const Hex& h);
+  BinaryLogStream& operator<<(const char* str);
+  BinaryLogStream& operator<<(const unsigned char* str) {
+    return *this << reinterpret_cast<const char*>(str);
+  }
+  BinaryLogStream& operator<<(const std::string& str) {
+    appendString(str.data(), str.size());
+    return *this;
+  }
+  BinaryLogStream& operator<<(const GeneralTemplate& g) {
+    appendString(g.data_, g.len_);
+    return *this;
+  }
+
+ private:
+  friend class BinaryLogger;
+
+  void appendString(const char* data, size_t len);
+
+  Buffer buffer_;
+};
+
+class BinaryLogger : noncopyable {
+ public:
+  explicit BinaryLogger(LogSite* site);
+  ~BinaryLogger();
+
+  BinaryLogStream& stream() { return stream_; }
+
+  // 未设置输出函数时，记录在本线程格式化为文本交给 Logger 的输出
+  static void setOutput(Logger::OutputFunc);
+  static void setFlush(Logger::FlushFunc);
+  // 内联的站点定义丢失后本文件中该站点的记录都无法解码，
+  // 可设为转发到 AsyncLogging::appendCritical，未设置时使用 setOutput 的函数
+  static void setSiteOutput(Logger::OutputFunc);
+
+  // 每个滚动后的日志文件开头写入的文件头，用于 AsyncLogging::setFileHeader
+  static std::string fileHeader();
+  // 'D' 丢弃记录，用于 AsyncLogging::setDropMarker
+  static std::string dropMarker(uint64_t lines, uint64_t bytes);
+
+ private:
+  LogSite* site_;
+  int lengthOffset_;
+  int64_t microSecondsSinceEpoch_;
+  BinaryLogStream stream_;
+};
+
+// 离线解码，将二进制记录还原为与文本日志一致的格式
+class BinaryLogDecoder : noncopyable {
+ public:
+  using OutputFunc = std::function<void(const char* msg, int len)>;
+
+  static const char kMagic[];
+  static const int kMagicLength = 8;
+
+  // 先收集全部站点定义再解码记录；损坏的数据跳过后继续解码，
+  // 返回无法解析的记录数，连续的坏数据计为一条
+  int decode(const char* data, size_t len, const OutputFunc& output);
+
+ private:
+  struct SiteInfo {
+    std::string basename;
+    int line;
+    int level;
+    std::string func;
+  };
+
+  // 返回下一条记录的位置，数据不完整时返回 nullptr；
+  // emit 为 false 时只收集站点定义，resync 表示正在查找记录边界
+  const char* decodeRecord(const char* cur, const char* end, bool emit,
+                           bool resync, const OutputFunc& output, int* errors);
+
+  std::unordered_map<uint32_t, SiteInfo> sites_;
+};
+
+#define TINYWEB_LOG_SITE(level, func)                                     \
+  ([](const char* f) -> LogSite* {                                        \
+    static LogSite site(TINYWEB_SOURCE_FILE, __LINE__, level, f);         \
+    return &site;                                                         \
+  }(func))
+
+#define BLOG_TRACE                \
+  if (TINYWEB_LOG_ENABLED(TRACE)) \
+  BinaryLogger(TINYWEB_LOG_SITE(Logger::TRACE, __func__)).stream()
+#define BLOG_DEBUG                \
+  if (TINYWEB_LOG_ENABLED(DEBUG)) \
+  BinaryLogger(TINYWEB_LOG_SITE(Logger::DEBUG, __func__)).stream()
+#define BLOG_INFO                \
+  if (TINYWEB_LOG_ENABLED(INFO)) \
+  BinaryLogger(TINYWEB_LOG_SITE(Logger::INFO, nullptr)).stream()
+#define BLOG_WARN                \
+  if (TINYWEB_LOG_ENABLED(WARN)) \
+  BinaryLogger(TINYWEB_LOG_SITE(Logger::WARN, nullptr)).stream()
+#define BLOG_ERROR                \
+  if (TINYWEB_LOG_ENABLED(ERROR)) \
+  BinaryLogger(TINYWEB_LOG_SITE(Logger::ERROR, nullptr)).stream()
+#define BLOG_FATAL \
+  BinaryLogger(TINYWEB_LOG_SITE(Logger::FATAL, nullptr)).stream()
+
+}  // namespace base
+}  // namespace TinyWeb
+
+#endif  // SRC_BASE_INCLUDE_BINARYLOGGING_H_
@@ -0,0 +1,51 @@
+#ifndef SRC_BASE_INCLUDE_CPUTOPOLOGY_H_
+#define SRC_BASE_INCLUDE_CPUTOPOLOGY_H_
+
+#include <string>
+#include <vector>
+
+namespace TinyWeb {
+namespace base {
+// 从 sysfs 读取逻辑 CPU 所在的物理核、插槽和 NUMA 节点，
+// 只包含当前进程允许运行的 CPU（受 cgroup/taskset 限制）
+class CpuTopology {
+ public:
+  struct Cpu {
+    int id;
+    int core;     // topology/core_id，同一插槽内唯一
+    int package;  // topology/physical_package_id
+    int node;     // NUMA 节点，没有 NUMA 信息时为 0
+  };
+
+  // 进程内只探测一次
+  static const CpuTopology &instance();
+
+  // allowedOnly 为 false 时保留不在当前线程亲和性掩码中的 CPU
+  explicit CpuTopology(const std::string &sysfsRoot = "/sys/devices/system",
+                       bool allowedOnly = true);
+
+  const std::vector<Cpu> &cpus() const { return cpus_; }
+  int numNodes() const { return numNodes_; }
+  // 未知的 CPU 返回 -1
+  int nodeOf(int cpu) const;
+
+  // 分配 loop 时的 CPU 顺序：先取每个物理核的第一个逻辑 CPU，
+  // 在 NUMA 节点之间轮流；物理核用完后再取超线程
+  std::vector<int> spreadOrder() const;
+
+  // 解析 "0-3,8,10-11" 形式的 CPU 列表
+  static std::vector<int> parseCpuList(const std::string &list);
+  // 将当前线程绑定到 cpus，失败返回 false
+  static bool bindCurrentThread(const std::vector<int> &cpus);
+  // 当前线程之后首次访问的内存页优先分配在 node 上（MPOL_PREFERRED），
+  // 内存不足时退回其他节点
+  static bool preferNode(int node);
+
+ private:
+  std::vector<Cpu> cpus_;
+  int numNodes_;
+};
+}  // namespace base
+}  // namespace TinyWeb
+
+#endif  // SRC_BASE_INCLUDE_CPUTOPOLOGY_H_
\ No newline at end of file
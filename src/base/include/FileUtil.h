@@ -2,6 +2,7 @@
 #define SRC_BASE_INCLUDE_FILEUTIL_H_
 
 #include <stdio.h>
+#include <sys/uio.h>
 
 #include <string>
 
@@ -9,12 +10,23 @@
 
 namespace TinyWeb {
 namespace base {
+struct FileOptions {
+  // 绕过 stdio 缓冲，直接 write/writev 到文件描述符
+  bool directWrite = false;
+  // 每次 fallocate 预分配的字节数，0 表示不预分配
+  off_t preallocateBytes = 0;
+  // 每写入多少字节调用一次 sync_file_range 异步回写，0 表示不调用
+  off_t syncRangeBytes = 0;
+};
+
 class FileUtil : noncopyable {
  public:
-  explicit FileUtil(std::string& fileName);
+  explicit FileUtil(std::string& fileName,
+                    const FileOptions& options = FileOptions());
   ~FileUtil();
 
   void append(const char* data, size_t len);
+  void append(const struct iovec* iov, int iovcnt);
 
   void flush();
 
@@ -22,10 +34,18 @@ class FileUtil : noncopyable {
 
  private:
   size_t write(const char* data, size_t len);
+  void appendDirect(struct iovec* iov, int iovcnt);
+  void afterDirectWrite();
+  void releasePreallocated();
 
+  const FileOptions options_;
   FILE* fp_;
+  int fd_;
   char buffer_[64 * 1024];
   off_t writtenBytes_;
+  off_t startOffset_;
+  off_t allocatedEnd_;
+  off_t syncedEnd_;
 };
 }  // namespace base
 }  // namespace TinyWeb
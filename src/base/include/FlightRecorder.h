@@ -0,0 +1,34 @@
+#ifndef SRC_BASE_INCLUDE_FLIGHTRECORDER_H_
+#define SRC_BASE_INCLUDE_FLIGHTRECORDER_H_
+
+#include <string>
+
+#include "Logging.h"
+
+namespace TinyWeb {
+namespace base {
+// 进程内的日志黑匣子: 无锁环形缓冲区始终保存最近 records 条日志，
+// 包括低于输出级别的 TRACE/DEBUG，LOG_FATAL、BLOG_FATAL 或致命信号时写入 dumpPath
+// 低于 TINYWEB_MIN_LOG_LEVEL 的调用点在编译期已被删除，运行时无法记录。
+// 定义 NDEBUG 时下限默认为 INFO，要记录 TRACE/DEBUG 需以
+// -DTINYWEB_MIN_LOG_LEVEL=0 构建库和使用方
+class FlightRecorder {
+ public:
+  // 每条记录的最大长度，超出部分截断
+  static const int kRecordSize = 256;
+
+  // 在启动时调用一次，records 向上取整为 2 的幂
+  // level 低于本库构建时的 TINYWEB_MIN_LOG_LEVEL 时输出一条警告
+  static void enable(const std::string& dumpPath, size_t records = 4096,
+                     Logger::LogLevel level = Logger::TRACE,
+                     bool installSignalHandlers = true);
+  static bool enabled();
+
+  static void record(const char* data, int len);
+  // 异步信号安全，同一进程内只会写出一次
+  static void dump();
+};
+}  // namespace base
+}  // namespace TinyWeb
+
+#endif  // SRC_BASE_INCLUDE_FLIGHTRECORDER_H_
\ No newline at end of file
@@ -0,0 +1,74 @@
+#ifndef SRC_BASE_INCLUDE_HISTOGRAM_H_
+#define SRC_BASE_INCLUDE_HISTOGRAM_H_
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "noncopyable.h"
+
+namespace TinyWeb {
+namespace base {
+// 单写者、多读者的无锁直方图。每个 2 的幂区间再均分为 4 个桶，
+// 分位数的相对误差不超过 25%。record 只能由一个线程调用，
+// snapshot 可在任意线程调用，读到的各字段之间可能相差正在写入的一次记录
+class Histogram : noncopyable {
+ public:
+  static const int kSubBucketBits = 2;
+  static const int kSubBuckets = 1 << kSubBucketBits;
+  static const int kNumBuckets = (64 - kSubBucketBits + 1) * kSubBuckets;
+
+  struct Snapshot {
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    uint64_t max = 0;
+    std::vector<uint64_t> buckets;
+
+    double mean() const { return count ? static_cast<double>(sum) / count : 0; }
+    // p 取 [0, 1]，返回所在桶的上界，不超过 max
+    uint64_t percentile(double p) const;
+    std::string toString() const;
+  };
+
+  Histogram();
+
+  void record(uint64_t value) {
+    add(&buckets_[bucketIndex(value)], 1);
+    add(&count_, 1);
+    add(&sum_, value);
+    if (value > max_.load(std::memory_order_relaxed)) {
+      max_.store(value, std::memory_order_relaxed);
+    }
+  }
+
+  Snapshot snapshot() const;
+
+  static int bucketIndex(uint64_t value) {
+    if (value < kSubBuckets) {
+      return static_cast<int>(value);
+    }
+    int msb = 63 - __builtin_clzll(value);
+    int shift = msb - kSubBucketBits;
+    return (shift + 1) * kSubBuckets +
+           static_cast<int>((value >> shift) & (kSubBuckets - 1));
+  }
+  // 第 index 个桶的上界（不含）
+  static uint64_t bucketLimit(int index);
+
+ private:
+  // 只有一个写者，不需要 fetch_add 的总线锁
+  static void add(std::atomic<uint64_t> *counter, uint64_t n) {
+    counter->store(counter->load(std::memory_order_relaxed) + n,
+                   std::memory_order_relaxed);
+  }
+
+  std::atomic<uint64_t> buckets_[kNumBuckets];
+  std::atomic<uint64_t> count_;
+  std::atomic<uint64_t> sum_;
+  std::atomic<uint64_t> max_;
+};
+}  // namespace base
+}  // namespace TinyWeb
+
+#endif  // SRC_BASE_INCLUDE_HISTOGRAM_H_
\ No newline at end of file
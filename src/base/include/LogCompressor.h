@@ -0,0 +1,42 @@
+#ifndef SRC_BASE_INCLUDE_LOGCOMPRESSOR_H_
+#define SRC_BASE_INCLUDE_LOGCOMPRESSOR_H_
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+
+#include "Thread.h"
+#include "noncopyable.h"
+
+namespace TinyWeb {
+namespace base {
+// 在独立线程中把滚动完成的日志文件压缩为 .gz，并只保留最近 retention 个
+class LogCompressor : noncopyable {
+ public:
+  explicit LogCompressor(int level = 6, int retention = 0);
+  ~LogCompressor();
+
+  void start();
+  // 处理完队列中剩余的文件后退出
+  void stop();
+
+  void compress(const std::string& filename);
+
+ private:
+  void threadFunc();
+  bool compressFile(const std::string& filename);
+  void removeOldFiles(const std::string& filename);
+
+  const int level_;
+  const int retention_;
+  bool running_;
+  Thread thread_;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  std::deque<std::string> queue_;
+};
+}  // namespace base
+}  // namespace TinyWeb
+
+#endif  // SRC_BASE_INCLUDE_LOGCOMPRESSOR_H_
\ No newline at end of file
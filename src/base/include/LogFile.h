@@ -1,6 +1,7 @@
 #ifndef SRC_BASE_INCLUDE_LOGFILE_H_
 #define SRC_BASE_INCLUDE_LOGFILE_H_
 
+#include <functional>
 #include <memory>
 #include <mutex>
 
@@ -11,22 +12,37 @@ namespace TinyWeb {
 namespace base {
 class LogFile : noncopyable {
  public:
+  // 每次打开新文件时写入的文件头
+  using HeaderFunc = std::function<std::string()>;
+  // 文件滚动后以旧文件名回调，此时旧文件已关闭
+  using RollCallback = std::function<void(const std::string &)>;
+
   LogFile(const std::string &basename, off_t rollSize, int flushInterval = 3,
-          int checkEveryN = 1024);
+          int checkEveryN = 1024, const HeaderFunc &header = HeaderFunc(),
+          const FileOptions &options = FileOptions());
   ~LogFile();
 
   void append(const char *data, int len);
+  // 一次系统调用写出多段数据，整批写完后再检查是否需要滚动
+  void append(const struct iovec *iov, int iovcnt);
   void flush();
   bool rollFile();
 
+  void setRollCallback(const RollCallback &cb) { rollCallback_ = cb; }
+
  private:
   static std::string getLogFileName(const std::string &basename, time_t *now);
   void appendInLock(const char *data, int len);
+  void afterAppend();
 
   const std::string basename_;
   const off_t rollSize_;
   const int flushInterval_;
   const int checkEveryN_;
+  const HeaderFunc header_;
+  const FileOptions options_;
+  RollCallback rollCallback_;
+  std::string filename_;
 
   int count_;
 
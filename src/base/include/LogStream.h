@@ -16,6 +16,14 @@ class GeneralTemplate {
   int len_;
 };
 
+// 以 0x 前缀的十六进制输出整数
+class Hex {
+ public:
+  explicit Hex(unsigned long long value) : value_(value) {}
+
+  unsigned long long value_;
+};
+
 class LogStream : noncopyable {
  public:
   using Buffer = FixedBuffer<kSmallBuffer>;
@@ -44,6 +52,7 @@ class LogStream : noncopyable {
   LogStream& operator<<(const Buffer& buf);
 
   LogStream& operator<<(const GeneralTemplate& g);
+  LogStream& operator<<(const Hex& h);
 
  private:
   static const int kMaxNumericSize = 48;
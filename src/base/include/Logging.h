@@ -1,17 +1,22 @@
 #ifndef SRC_BASE_INCLUDE_LOGGING_H_
 #define SRC_BASE_INCLUDE_LOGGING_H_
 
+#include <atomic>
 #include <cstring>
 #include <functional>
+#include <type_traits>
 
 #include "LogStream.h"
 #include "Timestamp.h"
+#include "noncopyable.h"
 
 namespace TinyWeb {
 namespace base {
 class SourceFile {
  public:
-  explicit SourceFile(const char* filename) : data_(filename) {
+  constexpr SourceFile(const char* data, int size) : data_(data), size_(size) {}
+
+  SourceFile(const char* filename) : data_(filename) {
     const char* slash = strrchr(filename, '/');
     if (slash) {
       data_ = slash + 1;
@@ -19,8 +24,19 @@ class SourceFile {
     size_ = static_cast<int>(strlen(data_));
   }
 
+  // 返回最后一个 '/' 之后的下标，二分递归使深度只有 log(n)
+  static constexpr int basenameOffset(const char* s, int begin, int end) {
+    return end - begin <= 1
+               ? (end > begin && s[begin] == '/' ? begin + 1 : 0)
+               : maxOffset(basenameOffset(s, begin, (begin + end) / 2),
+                           basenameOffset(s, (begin + end) / 2, end));
+  }
+
   const char* data_;
   int size_;
+
+ private:
+  static constexpr int maxOffset(int a, int b) { return a > b ? a : b; }
 };
 
 class Logger {
@@ -35,16 +51,30 @@ class Logger {
     LEVEL_COUNT,
   };
 
-  Logger(const char* file, int line);
-  Logger(const char* file, int line, LogLevel level);
-  Logger(const char* file, int line, LogLevel level, const char* func);
+  Logger(SourceFile file, int line);
+  Logger(SourceFile file, int line, LogLevel level);
+  Logger(SourceFile file, int line, LogLevel level, const char* func);
+  // LOG_* 宏使用，sinks 为 kOutput/kRecord 的组合
+  Logger(SourceFile file, int line, LogLevel level, const char* func,
+         int sinks);
   ~Logger();
 
+  // kOutput: 写入 setOutput 设置的输出，kRecord: 写入 FlightRecorder
+  enum Sink { kOutput = 1, kRecord = 2 };
+  static int sinks(LogLevel fileLevel, LogLevel level);
+
   LogStream& stream() { return impl_.stream_; }
 
   static LogLevel logLevel();
   static void setLogLevel(LogLevel level);
 
+  // 按文件或模块覆盖日志级别，pattern 为文件名(如 "EPollPoller.cpp")
+  // 或路径中的某级目录名(如 "net")，后设置的优先
+  static void setLogLevel(const char* pattern, LogLevel level);
+  static void clearLogLevel(const char* pattern);
+  // 源文件当前生效的日志级别，返回的引用在进程生命周期内有效
+  static const std::atomic<LogLevel>& fileLogLevel(const char* file);
+
   using OutputFunc = std::function<void(const char* msg, int len)>;
   using FlushFunc = std::function<void()>;
   static void setOutput(OutputFunc);
@@ -54,7 +84,8 @@ class Logger {
   class Impl {
    public:
     using LogLevel = Logger::LogLevel;
-    Impl(LogLevel level, int savedErrno, const char* file, int line);
+    Impl(LogLevel level, int savedErrno, SourceFile file, int line,
+         int sinks);
     void formatTime();
     void finish();
 
@@ -63,28 +94,191 @@ class Logger {
     LogLevel level_;
     int line_;
     SourceFile basename_;
+    int sinks_;
   };
 
   Impl impl_;
 };
 
+// 采样或限速日志在某个调用点的判定结果
+// suppressed 为该调用点自上次输出以来被抑制的条数
+struct LogSample {
+  explicit operator bool() const { return enabled; }
+
+  bool enabled;
+  uint64_t suppressed;
+};
+
+inline LogStream& operator<<(LogStream& s, const LogSample& sample) {
+  if (sample.suppressed > 0) {
+    s << "[suppressed " << sample.suppressed << "] ";
+  }
+  return s;
+}
+
+// 采样/限速日志的调用点状态，作为函数内 static 常量初始化，全部操作无锁
+// 时间使用 CLOCK_MONOTONIC，不受系统时钟调整影响
+class LogRateSite : noncopyable {
+ public:
+  constexpr LogRateSite() : count_(0), suppressed_(0), next_(0) {}
+
+  // 第 1, n+1, 2n+1 ... 次输出
+  LogSample everyN(uint64_t n) {
+    uint64_t count = count_.fetch_add(1, std::memory_order_relaxed);
+    if (n <= 1 || count % n == 0) {
+      return pass();
+    }
+    return suppress();
+  }
+
+  // 只输出前 n 次，之后的调用全部抑制并计入 suppressed()
+  LogSample firstN(uint64_t n) {
+    if (count_.load(std::memory_order_relaxed) >= n) {
+      return suppress();
+    }
+    uint64_t count = count_.fetch_add(1, std::memory_order_relaxed);
+    return count < n ? LogSample{true, 0} : suppress();
+  }
+
+  // 每 ms 毫秒最多输出一次
+  LogSample everyMs(int64_t ms) {
+    int64_t now = Timestamp::monotonic().microSecondsSinceEpoch();
+    int64_t next = next_.load(std::memory_order_relaxed);
+    if (now >= next && next_.compare_exchange_strong(
+                           next, now + ms * 1000, std::memory_order_relaxed)) {
+      return pass();
+    }
+    return suppress();
+  }
+
+  // 令牌桶: 平均每秒 rate 条，最多突发 burst 条，rate <= 0 时全部抑制
+  // 以 GCRA 形式实现，桶状态就是一个理论到达时间
+  LogSample tokenBucket(double rate, int burst) {
+    if (!(rate > 0)) {
+      return suppress();
+    }
+    int64_t now = Timestamp::monotonic().microSecondsSinceEpoch();
+    int64_t interval = static_cast<int64_t>(1000000 / rate);
+    int64_t tolerance = interval * (burst > 1 ? burst - 1 : 0);
+    int64_t tat = next_.load(std::memory_order_relaxed);
+    for (;;) {
+      if (tat - tolerance > now) {
+        return suppress();
+      }
+      int64_t newTat = (tat > now ? tat : now) + interval;
+      if (next_.compare_exchange_weak(tat, newTat,
+                                      std::memory_order_relaxed)) {
+        return pass();
+      }
+    }
+  }
+
+  // 自上次输出以来被抑制的条数；firstN 不再输出，即为达到上限后的总数
+  uint64_t suppressed() const {
+    return suppressed_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  LogSample pass() {
+    return LogSample{true, suppressed_.exchange(0, std::memory_order_relaxed)};
+  }
+  LogSample suppress() {
+    suppressed_.fetch_add(1, std::memory_order_relaxed);
+    return LogSample{false, 0};
+  }
+
+  std::atomic<uint64_t> count_;
+  std::atomic<uint64_t> suppressed_;
+  std::atomic<int64_t> next_;
+};
+
 extern Logger::LogLevel g_logLevel;
+// 写入 FlightRecorder 的最低级别，未启用时为 LEVEL_COUNT
+extern Logger::LogLevel g_recordLevel;
 
 inline Logger::LogLevel Logger::logLevel() { return g_logLevel; }
 
+inline int Logger::sinks(LogLevel fileLevel, LogLevel level) {
+  return (level >= fileLevel ? kOutput : 0) |
+         (level >= g_recordLevel ? kRecord : 0);
+}
+
 const char* getErrnoMsg(int savedErrno);
 
-#define LOG_TRACE                          \
-  if (Logger::logLevel() == Logger::TRACE) \
-  Logger(__FILE__, __LINE__, Logger::TRACE, __func__).stream()
-#define LOG_DEBUG                          \
-  if (Logger::logLevel() <= Logger::DEBUG) \
-  Logger(__FILE__, __LINE__, Logger::DEBUG, __func__).stream()
-#define LOG_INFO \
-  if (Logger::logLevel() <= Logger::INFO) Logger(__FILE__, __LINE__).stream()
-#define LOG_WARN Logger(__FILE__, __LINE__, Logger::WARN).stream()
-#define LOG_ERROR Logger(__FILE__, __LINE__, Logger::ERROR).stream()
-#define LOG_FATAL Logger(__FILE__, __LINE__, Logger::FATAL).stream()
+// 编译期日志级别下限，低于该级别的调用点整体被删除，也不会写入 FlightRecorder
+// 例如 -DTINYWEB_MIN_LOG_LEVEL=2 只保留 INFO 及以上，FATAL 始终保留
+#ifndef TINYWEB_MIN_LOG_LEVEL
+#ifdef NDEBUG
+#define TINYWEB_MIN_LOG_LEVEL 2
+#else
+#define TINYWEB_MIN_LOG_LEVEL 0
+#endif
+#endif
+
+#define TINYWEB_BASENAME_OFFSET                                        \
+  std::integral_constant<int, ::TinyWeb::base::SourceFile::basenameOffset( \
+                                  __FILE__, 0, sizeof(__FILE__) - 1)>::value
+#define TINYWEB_SOURCE_FILE                   \
+  ::TinyWeb::base::SourceFile(                \
+      __FILE__ + TINYWEB_BASENAME_OFFSET,     \
+      static_cast<int>(sizeof(__FILE__)) - 1 - TINYWEB_BASENAME_OFFSET)
+
+// 每个调用点首次执行时缓存本文件的级别，之后只有一次加载和比较
+#define TINYWEB_FILE_LOG_LEVEL()                                     \
+  ([]() -> Logger::LogLevel {                                        \
+    static const std::atomic<Logger::LogLevel>& fileLevel =          \
+        Logger::fileLogLevel(__FILE__);                              \
+    return fileLevel.load(std::memory_order_relaxed);                \
+  }())
+#define TINYWEB_LOG_ENABLED(level)                \
+  (TINYWEB_MIN_LOG_LEVEL <= Logger::level &&      \
+   TINYWEB_FILE_LOG_LEVEL() <= Logger::level)
+
+// 低于文件级别但不低于 g_recordLevel 的日志只写入 FlightRecorder
+#define TINYWEB_LOG_SINKS(level)                                  \
+  (TINYWEB_MIN_LOG_LEVEL <= Logger::level                         \
+       ? Logger::sinks(TINYWEB_FILE_LOG_LEVEL(), Logger::level)   \
+       : 0)
+#define TINYWEB_LOG(level, func)                                  \
+  if (int tinywebLogSinks = TINYWEB_LOG_SINKS(level))             \
+  Logger(TINYWEB_SOURCE_FILE, __LINE__, Logger::level, func,      \
+         tinywebLogSinks)                                         \
+      .stream()
+
+#define LOG_TRACE TINYWEB_LOG(TRACE, __func__)
+#define LOG_DEBUG TINYWEB_LOG(DEBUG, __func__)
+#define LOG_INFO TINYWEB_LOG(INFO, nullptr)
+#define LOG_WARN TINYWEB_LOG(WARN, nullptr)
+#define LOG_ERROR TINYWEB_LOG(ERROR, nullptr)
+#define LOG_FATAL Logger(TINYWEB_SOURCE_FILE, __LINE__, Logger::FATAL).stream()
+
+// 采样与限速，level 为 TRACE ... ERROR，例如 LOG_EVERY_MS(ERROR, 1000) << ...
+// 输出时在正文前附上自上次输出以来被抑制的条数。与 LOG_* 相同，低于文件级别
+// 但不低于 g_recordLevel 的日志只写入 FlightRecorder
+#define TINYWEB_LOG_RATE_SITE() \
+  ([]() -> LogRateSite& {       \
+    static LogRateSite site;    \
+    return site;                \
+  }())
+#define TINYWEB_LOG_SAMPLED(level, site, sample)                      \
+  if (int tinywebLogSinks = TINYWEB_LOG_SINKS(level))                 \
+    if (LogSample tinywebLogSample = (site).sample)                   \
+  Logger(TINYWEB_SOURCE_FILE, __LINE__, Logger::level, nullptr,       \
+         tinywebLogSinks)                                             \
+      .stream()                                                       \
+      << tinywebLogSample
+
+#define LOG_EVERY_N(level, n) \
+  TINYWEB_LOG_SAMPLED(level, TINYWEB_LOG_RATE_SITE(), everyN(n))
+#define LOG_FIRST_N(level, n) \
+  TINYWEB_LOG_SAMPLED(level, TINYWEB_LOG_RATE_SITE(), firstN(n))
+#define LOG_EVERY_MS(level, ms) \
+  TINYWEB_LOG_SAMPLED(level, TINYWEB_LOG_RATE_SITE(), everyMs(ms))
+#define LOG_RATE_LIMITED(level, rate, burst) \
+  TINYWEB_LOG_SAMPLED(level, TINYWEB_LOG_RATE_SITE(), tokenBucket(rate, burst))
+// 使用调用方提供的 LogRateSite，便于读取 suppressed()，例如
+//   static LogRateSite site; LOG_SAMPLED(WARN, site, firstN(10)) << ...
+#define LOG_SAMPLED(level, site, sample) TINYWEB_LOG_SAMPLED(level, site, sample)
 
 }  // namespace base
 }  // namespace TinyWeb
@@ -0,0 +1,59 @@
+#ifndef SRC_BASE_INCLUDE_MPSCQUEUE_H_
+#define SRC_BASE_INCLUDE_MPSCQUEUE_H_
+
+#include <atomic>
+#include <cstddef>
+
+#include "noncopyable.h"
+
+namespace TinyWeb {
+namespace base {
+// 多生产者单消费者的无锁侵入式队列，T 需要有 T* next 成员
+// 生产者以 CAS 压栈，消费者一次取走全部节点并反转为先进先出顺序
+template <typename T>
+class MpscQueue : noncopyable {
+ public:
+  MpscQueue() : head_(nullptr) {}
+
+  void push(T* node) { pushChain(node, node); }
+
+  // newest->next ... ->oldest 已按从新到旧的顺序链接，整条链一次入队
+  void pushChain(T* newest, T* oldest) {
+    T* head = head_.load(std::memory_order_relaxed);
+    do {
+      oldest->next = head;
+    } while (!head_.compare_exchange_weak(head, newest,
+                                          std::memory_order_release,
+                                          std::memory_order_relaxed));
+  }
+
+  // 仅消费者调用，返回按入队顺序链接的全部节点，队列为空时返回 nullptr
+  // count 不为空时写入取出的节点数
+  T* popAll(size_t* count = nullptr) {
+    T* node = head_.exchange(nullptr, std::memory_order_acquire);
+    T* reversed = nullptr;
+    size_t n = 0;
+    while (node) {
+      T* next = node->next;
+      node->next = reversed;
+      reversed = node;
+      node = next;
+      ++n;
+    }
+    if (count) {
+      *count = n;
+    }
+    return reversed;
+  }
+
+  bool empty() const {
+    return head_.load(std::memory_order_relaxed) == nullptr;
+  }
+
+ private:
+  std::atomic<T*> head_;
+};
+}  // namespace base
+}  // namespace TinyWeb
+
+#endif  // SRC_BASE_INCLUDE_MPSCQUEUE_H_
\ No newline at end of file
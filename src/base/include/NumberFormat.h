@@ -0,0 +1,26 @@
+#ifndef SRC_BASE_INCLUDE_NUMBERFORMAT_H_
+#define SRC_BASE_INCLUDE_NUMBERFORMAT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace TinyWeb {
+namespace base {
+// 以下函数向 buf 写入不以 '\0' 结尾的字符串并返回长度，
+// 调用方需保证 buf 至少有 kMaxNumberFormatSize 字节
+const int kMaxNumberFormatSize = 32;
+
+// 十进制整数，每次查表输出两位
+size_t formatUnsigned(char* buf, unsigned long long v);
+size_t formatSigned(char* buf, long long v);
+
+// 小写十六进制，不带 0x 前缀
+size_t formatHex(char* buf, unsigned long long v);
+
+// 可往返的最短十进制表示 (Grisu2)，风格与 %g 一致:
+// 指数小于 -4 或不小于 17 时使用科学计数法
+size_t formatDouble(char* buf, double v);
+}  // namespace base
+}  // namespace TinyWeb
+
+#endif  // SRC_BASE_INCLUDE_NUMBERFORMAT_H_
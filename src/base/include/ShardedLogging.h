@@ -0,0 +1,50 @@
+#ifndef SRC_BASE_INCLUDE_SHARDEDLOGGING_H_
+#define SRC_BASE_INCLUDE_SHARDEDLOGGING_H_
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "LogFile.h"
+#include "noncopyable.h"
+
+namespace TinyWeb {
+namespace base {
+// 每个线程写入自己的 LogFile 分片 basename.<shard>.<time>.log，线程之间没有交接
+// 未 attachThread 的线程写入共享的 basename.<time>.log
+// 分片按时间戳合并见 tools/logmerge
+class ShardedLogging : noncopyable {
+ public:
+  ShardedLogging(const std::string& basename, off_t rollSize,
+                 int flushInterval = 3);
+  // 析构前写日志的线程需已退出
+  ~ShardedLogging();
+
+  // 在写日志的线程中调用，例如 EventLoopThread 的 ThreadInitCallback
+  void attachThread(const std::string& shard);
+
+  // 作为 Logger::setOutput 的输出
+  void append(const char* logline, int len);
+  // 刷新调用线程的分片，空闲的线程需定期调用，例如 EventLoop::runEvery
+  // 共享文件由 LogFile 按 flushInterval 自行刷新
+  void flush();
+
+ private:
+  LogFile* localShard() const;
+
+  const std::string basename_;
+  const off_t rollSize_;
+  const int flushInterval_;
+  const uint64_t id_;
+  std::mutex mutex_;
+  std::vector<std::unique_ptr<LogFile>> shards_;
+  LogFile fallback_;
+
+  static std::atomic<uint64_t> numCreated_;
+};
+}  // namespace base
+}  // namespace TinyWeb
+
+#endif  // SRC_BASE_INCLUDE_SHARDEDLOGGING_H_
\ No newline at end of file
@@ -0,0 +1,179 @@
+#ifndef SRC_BASE_INCLUDE_SMALLFUNCTION_H_
+#define SRC_BASE_INCLUDE_SMALLFUNCTION_H_
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// SmallFunction 默认的内联存储大小，可在编译时覆盖
+#ifndef TINYWEB_SMALL_FUNCTION_SIZE
+#define TINYWEB_SMALL_FUNCTION_SIZE 64
+#endif
+
+namespace TinyWeb {
+namespace base {
+template <typename Signature,
+          size_t InlineSize = TINYWEB_SMALL_FUNCTION_SIZE>
+class SmallFunction;
+
+// 只可移动的可调用对象，不超过 InlineSize 的可调用对象直接存放在内部，
+// 不分配堆内存，更大的退化为堆上存放
+template <typename R, typename... Args, size_t InlineSize>
+class SmallFunction<R(Args...), InlineSize> {
+ public:
+  SmallFunction() : ops_(nullptr) {}
+  SmallFunction(std::nullptr_t) : ops_(nullptr) {}
+
+  template <typename F,
+            typename = typename std::enable_if<!std::is_same<
+                typename std::decay<F>::type, SmallFunction>::value>::type>
+  SmallFunction(F&& f) : ops_(nullptr) {
+    using Functor = typename std::decay<F>::type;
+    if (!isNull(f)) {
+      construct<Functor>(std::forward<F>(f),
+                         std::integral_constant<bool, fitsInline<Functor>()>());
+    }
+  }
+
+  SmallFunction(SmallFunction&& other) noexcept : ops_(other.ops_) {
+    if (ops_) {
+      ops_->move(&storage_, &other.storage_);
+      other.ops_ = nullptr;
+    }
+  }
+
+  SmallFunction& operator=(SmallFunction&& other) noexcept {
+    if (this != &other) {
+      reset();
+      if (other.ops_) {
+        other.ops_->move(&storage_, &other.storage_);
+        ops_ = other.ops_;
+        other.ops_ = nullptr;
+      }
+    }
+    return *this;
+  }
+
+  SmallFunction& operator=(std::nullptr_t) {
+    reset();
+    return *this;
+  }
+
+  SmallFunction(const SmallFunction&) = delete;
+  SmallFunction& operator=(const SmallFunction&) = delete;
+
+  ~SmallFunction() { reset(); }
+
+  explicit operator bool() const { return ops_ != nullptr; }
+
+  R operator()(Args... args) const {
+    if (!ops_) {
+      throw std::bad_function_call();
+    }
+    return ops_->invoke(const_cast<Storage*>(&storage_),
+                        std::forward<Args>(args)...);
+  }
+
+  // 可调用对象是否存放在内部存储中，供测试和基准使用
+  bool isInline() const { return ops_ && !ops_->onHeap; }
+
+ private:
+  using Storage = typename std::aligned_storage<InlineSize,
+                                                alignof(std::max_align_t)>::type;
+
+  struct Ops {
+    R (*invoke)(void* storage, Args&&... args);
+    // 从 src 移动构造到 dst，并销毁 src
+    void (*move)(void* dst, void* src);
+    void (*destroy)(void* storage);
+    bool onHeap;
+  };
+
+  template <typename F>
+  static constexpr bool fitsInline() {
+    return sizeof(F) <= sizeof(Storage) &&
+           alignof(F) <= alignof(Storage) &&
+           std::is_nothrow_move_constructible<F>::value;
+  }
+
+  template <typename F>
+  struct InlineOps {
+    static R invoke(void* storage, Args&&... args) {
+      return (*static_cast<F*>(storage))(std::forward<Args>(args)...);
+    }
+    static void move(void* dst, void* src) {
+      new (dst) F(std::move(*static_cast<F*>(src)));
+      static_cast<F*>(src)->~F();
+    }
+    static void destroy(void* storage) { static_cast<F*>(storage)->~F(); }
+
+    static const Ops kOps;
+  };
+
+  template <typename F>
+  struct HeapOps {
+    static F* get(void* storage) { return *static_cast<F**>(storage); }
+    static R invoke(void* storage, Args&&... args) {
+      return (*get(storage))(std::forward<Args>(args)...);
+    }
+    static void move(void* dst, void* src) {
+      *static_cast<F**>(dst) = get(src);
+    }
+    static void destroy(void* storage) { delete get(storage); }
+
+    static const Ops kOps;
+  };
+
+  template <typename F>
+  static bool isNull(const F&) {
+    return false;
+  }
+  template <typename F>
+  static bool isNull(F* f) {
+    return f == nullptr;
+  }
+  template <typename Sig>
+  static bool isNull(const std::function<Sig>& f) {
+    return !f;
+  }
+
+  template <typename Functor, typename F>
+  void construct(F&& f, std::true_type) {
+    new (&storage_) Functor(std::forward<F>(f));
+    ops_ = &InlineOps<Functor>::kOps;
+  }
+  template <typename Functor, typename F>
+  void construct(F&& f, std::false_type) {
+    *reinterpret_cast<Functor**>(&storage_) = new Functor(std::forward<F>(f));
+    ops_ = &HeapOps<Functor>::kOps;
+  }
+
+  void reset() {
+    if (ops_) {
+      ops_->destroy(&storage_);
+      ops_ = nullptr;
+    }
+  }
+
+  Storage storage_;
+  const Ops* ops_;
+};
+
+template <typename R, typename... Args, size_t InlineSize>
+template <typename F>
+const typename SmallFunction<R(Args...), InlineSize>::Ops
+    SmallFunction<R(Args...), InlineSize>::InlineOps<F>::kOps = {
+        &InlineOps<F>::invoke, &InlineOps<F>::move, &InlineOps<F>::destroy,
+        false};
+
+template <typename R, typename... Args, size_t InlineSize>
+template <typename F>
+const typename SmallFunction<R(Args...), InlineSize>::Ops
+    SmallFunction<R(Args...), InlineSize>::HeapOps<F>::kOps = {
+        &HeapOps<F>::invoke, &HeapOps<F>::move, &HeapOps<F>::destroy, true};
+}  // namespace base
+}  // namespace TinyWeb
+
+#endif  // SRC_BASE_INCLUDE_SMALLFUNCTION_H_
\ No newline at end of file
@@ -12,6 +12,12 @@ class Timestamp {
       : microSecondsSinceEpoch_(microSecondsSinceEpoch) {}
 
   static Timestamp now();
+  // CLOCK_MONOTONIC 时间，不受系统时间调整影响，只用于计算间隔和定时器
+  static Timestamp monotonic();
+  // 校准 TSC 后 now() 改为读取 TSC，只用于日志等显示用的时间戳，每秒与系统
+  // 时钟重新对齐以跟随 NTP。monotonic() 始终读取 CLOCK_MONOTONIC。
+  // 需在创建其他线程前调用；仅在支持 invariant TSC 的 x86 上生效，否则返回 false
+  static bool useTscClock(int calibrateMs = 20);
 
   std::string toString() const;
 
@@ -0,0 +1,167 @@
+#include <glob.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../include/AsyncLogging.h"
+#include "../include/Logging.h"
+
+using namespace TinyWeb::base;
+static const off_t kRollSize = 500 * 1000 * 1000;
+static const char* kBasename = "/tmp/AsyncLoggingBench";
+AsyncLogging* g_asyncLog = NULL;
+FileOptions g_fileOptions;
+AsyncLogging::OverflowPolicy g_policy = AsyncLogging::kUnbounded;
+
+// 每个线程自己累计写入的字节数，避免计数本身成为竞争点
+__thread uint64_t t_bytes = 0;
+
+void asyncLog(const char* msg, int len) {
+  t_bytes += len;
+  if (g_asyncLog) {
+    g_asyncLog->append(msg, len);
+  }
+}
+
+struct Result {
+  double seconds;
+  uint64_t lines;
+  uint64_t bytes;
+  uint64_t diskBytes;
+  uint64_t droppedBytes;
+  // 单次 LOG_INFO 调用耗时，单位 ns
+  std::vector<uint32_t> latencies;
+};
+
+// 返回并删除本次运行产生的日志文件
+uint64_t removeLogFiles() {
+  uint64_t total = 0;
+  std::string pattern = std::string(kBasename) + ".*.log";
+  glob_t result;
+  if (::glob(pattern.c_str(), 0, NULL, &result) == 0) {
+    for (size_t i = 0; i < result.gl_pathc; ++i) {
+      struct stat st;
+      if (::stat(result.gl_pathv[i], &st) == 0) {
+        total += st.st_size;
+      }
+      ::unlink(result.gl_pathv[i]);
+    }
+  }
+  ::globfree(&result);
+  return total;
+}
+
+Result bench(AsyncLogging::Mode mode, int numThreads, int linesPerThread,
+             const std::string& payload) {
+  removeLogFiles();
+  AsyncLogging log(kBasename, kRollSize, 3, mode);
+  log.setFileOptions(g_fileOptions);
+  log.setOverflowPolicy(g_policy);
+  g_asyncLog = &log;
+  log.start();
+
+  std::vector<std::vector<uint32_t>> latencies(numThreads);
+  std::vector<uint64_t> bytes(numThreads);
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (int t = 0; t < numThreads; ++t) {
+    threads.emplace_back([&, t]() {
+      std::vector<uint32_t>& lat = latencies[t];
+      lat.reserve(linesPerThread);
+      t_bytes = 0;
+      for (int i = 0; i < linesPerThread; ++i) {
+        auto begin = std::chrono::steady_clock::now();
+        LOG_INFO << payload << i;
+        auto end = std::chrono::steady_clock::now();
+        lat.push_back(static_cast<uint32_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin)
+                .count()));
+      }
+      bytes[t] = t_bytes;
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  auto end = std::chrono::steady_clock::now();
+
+  log.stop();
+  g_asyncLog = NULL;
+
+  Result result;
+  result.seconds = std::chrono::duration<double>(end - start).count();
+  result.lines = static_cast<uint64_t>(numThreads) * linesPerThread;
+  result.bytes = 0;
+  for (uint64_t b : bytes) {
+    result.bytes += b;
+  }
+  result.diskBytes = removeLogFiles();
+  result.droppedBytes = log.droppedBytes();
+  for (std::vector<uint32_t>& lat : latencies) {
+    result.latencies.insert(result.latencies.end(), lat.begin(), lat.end());
+  }
+  return result;
+}
+
+uint32_t percentile(std::vector<uint32_t>* values, double p) {
+  size_t n = static_cast<size_t>(p * (values->size() - 1));
+  std::nth_element(values->begin(), values->begin() + n, values->end());
+  return (*values)[n];
+}
+
+void report(const char* mode, size_t size, int numThreads, Result* r) {
+  const double kMB = 1024.0 * 1024.0;
+  printf("%-12s %6zu %7d %12.0f %9.1f %8u %8u %8u %10.1f %10.1f\n", mode, size,
+         numThreads, r->lines / r->seconds, r->bytes / kMB / r->seconds,
+         percentile(&r->latencies, 0.5), percentile(&r->latencies, 0.99),
+         percentile(&r->latencies, 0.999), r->diskBytes / kMB,
+         r->droppedBytes / kMB);
+}
+
+// 用法: AsyncLoggingBench [maxThreads] [linesPerThread] [direct]
+//                         [block|drop|sample]
+int main(int argc, char* argv[]) {
+  int maxThreads = argc > 1 ? atoi(argv[1]) : 8;
+  int linesPerThread = argc > 2 ? atoi(argv[2]) : 100 * 1000;
+  for (int i = 3; i < argc; ++i) {
+    std::string arg(argv[i]);
+    if (arg == "direct") {
+      g_fileOptions.directWrite = true;
+      g_fileOptions.preallocateBytes = 64 * 1024 * 1024;
+      g_fileOptions.syncRangeBytes = 8 * 1024 * 1024;
+    } else if (arg == "block") {
+      g_policy = AsyncLogging::kBlock;
+    } else if (arg == "drop") {
+      g_policy = AsyncLogging::kDropNewest;
+    } else if (arg == "sample") {
+      g_policy = AsyncLogging::kKeepOneInN;
+    }
+  }
+
+  Logger::setOutput(asyncLog);
+  printf("pid = %d, lines per thread = %d\n", getpid(), linesPerThread);
+  printf("%-12s %6s %7s %12s %9s %8s %8s %8s %10s %10s\n", "mode", "size",
+         "threads", "lines/s", "MB/s", "p50(ns)", "p99(ns)", "p999(ns)",
+         "disk(MB)", "drop(MB)");
+
+  const size_t kSizes[] = {16, 128, 1024};
+  for (size_t size : kSizes) {
+    std::string payload(size, 'x');
+    for (int n = 1; n <= maxThreads; n *= 2) {
+      Result shared =
+          bench(AsyncLogging::kSharedBuffer, n, linesPerThread, payload);
+      report("shared", size, n, &shared);
+      Result local =
+          bench(AsyncLogging::kThreadLocalBuffer, n, linesPerThread, payload);
+      report("threadlocal", size, n, &local);
+    }
+  }
+  return 0;
+}
\ No newline at end of file
@@ -1,6 +1,13 @@
+#include <assert.h>
+#include <stdint.h>
 #include <unistd.h>
 
+#include <string>
+#include <vector>
+
 #include "../include/AsyncLogging.h"
+#include "../include/BinaryLogging.h"
+#include "../include/FlightRecorder.h"
 #include "../include/Logging.h"
 
 using namespace TinyWeb::base;
@@ -21,6 +28,118 @@ void test_Logging() {
   }
 }
 
+void test_BinaryLogging() {
+  BLOG_DEBUG << "debug";
+  BLOG_INFO << "info " << 1 << ' ' << 2.5 << " " << std::string("string");
+  BLOG_WARN << "warn";
+  BLOG_ERROR << "error";
+}
+
+// 同一组参数分别经 LOG_* 和 BLOG_* 输出，解码结果除时间和行号外应与 LOG_* 一致
+#define LOG_SAMPLES(INFO, WARN, ERROR)                                        \
+  INFO << "signed " << -1 << ' ' << static_cast<short>(-32768) << ' '         \
+       << INT32_MIN << ' ' << 0;                                              \
+  INFO << "int64 " << INT64_MIN << ' ' << INT64_MAX << ' ' << UINT64_MAX;     \
+  WARN << "double " << -2.5 << " char " << 'c' << " hex "                     \
+       << Hex(0xdeadbeefcafeULL) << " bool " << true;                         \
+  ERROR << std::string("string ") << "" << static_cast<const char*>(NULL)     \
+        << ' ' << std::string(100, 'x')
+
+static void textSamples() { LOG_SAMPLES(LOG_INFO, LOG_WARN, LOG_ERROR); }
+
+static void binarySamples() { LOG_SAMPLES(BLOG_INFO, BLOG_WARN, BLOG_ERROR); }
+
+static std::vector<std::string> g_chunks;
+
+static void captureOutput(const char* msg, int len) {
+  g_chunks.push_back(std::string(msg, len));
+}
+
+static void stdoutOutput(const char* msg, int len) {
+  fwrite(msg, 1, len, stdout);
+}
+
+// 按行拆分并去掉开头的时间和结尾的行号，两组调用点只有行号不同
+static std::vector<std::string> stripTime(const std::string& text) {
+  std::vector<std::string> lines;
+  size_t begin = 0;
+  while (begin < text.size()) {
+    size_t end = text.find('\n', begin);
+    assert(end != std::string::npos);
+    size_t colon = text.rfind(':', end);
+    assert(colon != std::string::npos && colon > begin + 26);
+    lines.push_back(text.substr(begin + 26, colon - begin - 26));
+    begin = end + 1;
+  }
+  return lines;
+}
+
+static std::vector<std::string> decodeLines(const std::string& data,
+                                            int* errors) {
+  std::string text;
+  BinaryLogDecoder decoder;
+  *errors = decoder.decode(
+      data.data(), data.size(),
+      [&text](const char* msg, int len) { text.append(msg, len); });
+  return stripTime(text);
+}
+
+void test_BinaryRoundTrip() {
+  Logger::setOutput(captureOutput);
+  textSamples();
+  std::string text;
+  for (const std::string& chunk : g_chunks) {
+    text += chunk;
+  }
+  std::vector<std::string> expected = stripTime(text);
+  assert(expected.size() == 4);
+
+  g_chunks.clear();
+  BinaryLogger::setOutput(captureOutput);
+  binarySamples();
+  BinaryLogger::setOutput(Logger::OutputFunc());
+  Logger::setOutput(stdoutOutput);
+
+  std::string binary = BinaryLogger::fileHeader();
+  for (const std::string& chunk : g_chunks) {
+    binary += chunk;
+  }
+  int errors = 0;
+  assert(decodeLines(binary, &errors) == expected);
+  assert(errors == 0);
+
+  // 记录之间插入坏数据，跳过后应继续解码
+  std::string corrupted = BinaryLogger::fileHeader();
+  for (size_t i = 0; i < g_chunks.size(); ++i) {
+    corrupted += g_chunks[i];
+    if (i == g_chunks.size() / 2) {
+      corrupted += "\x7f\x01garbage\xff";
+    }
+  }
+  assert(decodeLines(corrupted, &errors) == expected);
+  assert(errors == 1);
+
+  // 截断的最后一条记录计为一个错误
+  std::string truncated = binary.substr(0, binary.size() - 3);
+  std::vector<std::string> lines = decodeLines(truncated, &errors);
+  assert(lines.size() == expected.size() - 1);
+  assert(std::equal(lines.begin(), lines.end(), expected.begin()));
+  assert(errors == 1);
+
+  g_chunks.clear();
+  printf("binary round trip ok\n");
+}
+
+void test_FlightRecorder() {
+  FlightRecorder::enable("FlightRecorder.dump", 64);
+  // 低于输出级别，只进入黑匣子
+  for (int i = 0; i < 100; ++i) {
+    LOG_TRACE << "trace " << i;
+  }
+  LOG_INFO << "info";
+  FlightRecorder::dump();
+}
+
 void test_AsyncLogging() {
   const int n = 1024 * 50;
   for (int i = 0; i < n; ++i) {
@@ -40,6 +159,9 @@ int main() {
   printf("pid = %d\n", getpid());
   AsyncLogging log(std::string("Logging"), kRollSize);
   test_Logging();
+  test_BinaryLogging();
+  test_BinaryRoundTrip();
+  test_FlightRecorder();
 
   sleep(1);
 
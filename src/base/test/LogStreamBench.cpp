@@ -0,0 +1,87 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#include "../include/LogStream.h"
+#include "../include/NumberFormat.h"
+
+using namespace TinyWeb::base;
+
+// 旧实现：逐位取余后反转，浮点数走 snprintf
+static const char digits[] = {'9', '8', '7', '6', '5', '4', '3', '2', '1', '0',
+                              '1', '2', '3', '4', '5', '6', '7', '8', '9'};
+
+template <typename T>
+size_t legacyFormatInteger(char* buf, T num) {
+  char* cur = buf;
+  const char* zero = digits + 9;
+  bool negative = (num < 0);
+
+  do {
+    int remainder = static_cast<int>(num % 10);
+    *(cur++) = zero[remainder];
+    num = num / 10;
+  } while (num != 0);
+
+  if (negative) {
+    *(cur++) = '-';
+  }
+  std::reverse(buf, cur);
+  return cur - buf;
+}
+
+size_t legacyFormatDouble(char* buf, double v) {
+  return snprintf(buf, kMaxNumberFormatSize, "%.12g", v);
+}
+
+template <typename Func>
+double bench(const char* name, int n, Func func) {
+  char buf[kMaxNumberFormatSize];
+  size_t total = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < n; ++i) {
+    total += func(buf, i);
+  }
+  auto end = std::chrono::steady_clock::now();
+  double ns = std::chrono::duration<double, std::nano>(end - start).count() / n;
+  printf("%-24s %8.2f ns/op (%zu bytes)\n", name, ns, total);
+  return ns;
+}
+
+int main(int argc, char* argv[]) {
+  int n = argc > 1 ? atoi(argv[1]) : 10 * 1000 * 1000;
+
+  // 无符号乘法回绕后再转回 int，避免有符号溢出，同时覆盖正负数
+  bench("legacy int", n, [](char* buf, int i) {
+    return legacyFormatInteger(buf, static_cast<int>(i * 7919u));
+  });
+  bench("table int", n, [](char* buf, int i) {
+    return formatSigned(buf, static_cast<int>(i * 7919u));
+  });
+  bench("legacy int64", n, [](char* buf, int i) {
+    return legacyFormatInteger(buf, i * 1000000007LL);
+  });
+  bench("table int64", n, [](char* buf, int i) {
+    return formatSigned(buf, i * 1000000007LL);
+  });
+  bench("legacy double", n, [](char* buf, int i) {
+    return legacyFormatDouble(buf, i * 1.000001);
+  });
+  bench("grisu double", n,
+        [](char* buf, int i) { return formatDouble(buf, i * 1.000001); });
+  bench("hex", n, [](char* buf, int i) {
+    return formatHex(buf, static_cast<unsigned long long>(i) * 2654435761U);
+  });
+
+  LogStream stream;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < n; ++i) {
+    stream << i << ' ' << i * 0.5 << ' ' << &stream;
+    stream.resetBuffer();
+  }
+  auto end = std::chrono::steady_clock::now();
+  printf("%-24s %8.2f ns/op\n", "LogStream line",
+         std::chrono::duration<double, std::nano>(end - start).count() / n);
+  return 0;
+}
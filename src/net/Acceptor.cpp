@@ -25,7 +25,7 @@ Acceptor::Acceptor(EventLoop *loop, const InetAddress &listenAddr,
                    bool reuseport)
     : loop_(loop) {
   // 创建网络套接字，返回文件描述符
-  acceptSock_ = new Socket(createNoneblocking());
+  acceptSock_ = std::make_shared<Socket>(createNoneblocking());
 
   acceptChannel_ = new Channel(loop, acceptSock_->fd());
 
@@ -37,9 +37,19 @@ Acceptor::Acceptor(EventLoop *loop, const InetAddress &listenAddr,
   acceptChannel_->setReadCallback(std::bind(&Acceptor::handleRead, this));
 }
 
+Acceptor::Acceptor(EventLoop *loop, Acceptor *shared)
+    : loop_(loop),
+      acceptSock_(shared->acceptSock_),
+      acceptChannel_(new Channel(loop, acceptSock_->fd())),
+      listenning_(shared->listenning_) {
+  acceptChannel_->setExclusive(true);
+  acceptChannel_->setReadCallback(std::bind(&Acceptor::handleRead, this));
+}
+
 Acceptor::~Acceptor() {
   acceptChannel_->disableAll();
   acceptChannel_->remove();
+  delete acceptChannel_;
 }
 
 void Acceptor::handleRead() {
@@ -53,19 +63,32 @@ void Acceptor::handleRead() {
     } else {
       ::close(connfd);
     }
-  } else {
-    LOG_ERROR << __FILE__ << ":" << __FUNCTION__ << ":" << __LINE__
-              << " accept err:" << errno;
-    if (errno == EMFILE) {
-      LOG_ERROR << __FILE__ << ":" << __FUNCTION__ << ":" << __LINE__
-                << "  sockfd reached limit";
+  } else if (errno != EAGAIN) {
+    // 共用监听套接字或 SO_REUSEPORT 时可能被别的线程抢先，返回 EAGAIN 不算错误；
+    // fd 耗尽时每次唤醒都会失败，限速避免日志刷屏
+    int savedErrno = errno;
+    LOG_EVERY_MS(ERROR, 1000) << __FILE__ << ":" << __FUNCTION__ << ":"
+                              << __LINE__ << " accept err:" << savedErrno;
+    if (savedErrno == EMFILE) {
+      LOG_EVERY_MS(ERROR, 1000) << __FILE__ << ":" << __FUNCTION__ << ":"
+                                << __LINE__ << "  sockfd reached limit";
     }
   }
 }
 
 void Acceptor::listen() {
   LOG_DEBUG << "Acceptor::listen begin to listen";
-  listenning_ = true;
-  acceptSock_->listen();
+  listenSocket();
   acceptChannel_->enableReading();
+}
+
+void Acceptor::listenSocket() {
+  if (!listenning_) {
+    listenning_ = true;
+    acceptSock_->listen();
+  }
+}
+
+bool Acceptor::attachReusePortCpuSteering(int groupSize) {
+  return acceptSock_->attachReusePortCpuSteering(groupSize);
 }
\ No newline at end of file
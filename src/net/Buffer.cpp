@@ -8,7 +8,7 @@ using namespace TinyWeb::net;
 const char Buffer::kCRLF[] = "\r\n";
 
 ssize_t Buffer::readFd(int fd, int *saveErrno) {
-  char extrabuf[65536] = {0};
+  char extrabuf[kExtraReadSize];
   struct iovec vec[2] = {0};
   const size_t writable = writeableBytes();
 
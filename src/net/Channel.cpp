@@ -7,7 +7,14 @@ using namespace TinyWeb::net;
 using namespace TinyWeb::base;
 
 Channel::Channel(EventLoop *loop, int fd)
-    : loop_(loop), fd_(fd), events_(0), revents_(0), index_(-1), tied_(false){};
+    : loop_(loop),
+      fd_(fd),
+      events_(0),
+      revents_(0),
+      edgeTriggered_(false),
+      exclusive_(false),
+      updatePending_(false),
+      tied_(false) {}
 
 void Channel::handleEvent(base::Timestamp receiveTime) {
   LOG_DEBUG << "Channel::handleEvent for fd=" << fd_ << " and tie is "
@@ -49,7 +56,8 @@ void Channel::handleEventWithGuard(base::Timestamp receiveTime) {
     }
   }
 
-  if (revents_ & (EPOLLIN | EPOLLPRI)) {
+  // 对端关闭写端时读到 0 再关闭连接
+  if (revents_ & (EPOLLIN | EPOLLPRI | EPOLLRDHUP)) {
     if (readCallback_) {
       readCallback_(receiveTime);
     }
@@ -10,10 +10,6 @@
 using namespace TinyWeb::net;
 using namespace TinyWeb::base;
 
-constexpr int kNew = -1;
-constexpr int kAdded = 1;
-constexpr int kDeleted = 2;
-
 EPollPoller::EPollPoller(EventLoop *loop)
     : Poller(loop),
       epollfd_(::epoll_create1(EPOLL_CLOEXEC)),
@@ -28,7 +24,7 @@ EPollPoller::~EPollPoller() { ::close(epollfd_); }
 TinyWeb::base::Timestamp EPollPoller::poll(int timeoutMs,
                                            ChannelList *activeChannels) {
   LOG_TRACE << "func=" << __FUNCTION__
-            << " => fd total count:" << channels_.size();
+            << " => fd total count:" << numChannels_;
   int numEvents = ::epoll_wait(epollfd_, events_.data(),
                                static_cast<int>(events_.size()), timeoutMs);
   int saveErrno = errno;
@@ -52,37 +48,40 @@ TinyWeb::base::Timestamp EPollPoller::poll(int timeoutMs,
 }
 
 void EPollPoller::updateChannel(Channel *channel) {
-  const int index = channel->index();
+  ChannelEntry &e = entry(channel);
+  const int events = channel->events();
   LOG_TRACE << "EPollPoller::updateChannel fd=" << channel->fd()
-            << " events=" << channel->events() << " index=" << index;
-  if (index == kNew || index == kDeleted) {
-    if (index == kNew) {
-      int fd = channel->fd();
-      channels_[fd] = channel;
-    }
-    channel->set_index(kAdded);
-    update(EPOLL_CTL_ADD, channel);
-  } else {
-    int fd = channel->fd();
-    if (channel->isNoneEvent()) {
-      update(EPOLL_CTL_DEL, channel);
-      channel->set_index(kDeleted);
+            << " events=" << events << " state=" << e.state;
+  if (e.state != kAdded) {
+    // 没有关注的事件时不必加入 epoll
+    if (!channel->isNoneEvent()) {
+      update(EPOLL_CTL_ADD, channel);
+      e.state = kAdded;
+      e.events = events;
     } else {
-      update(EPOLL_CTL_MOD, channel);
+      e.state = kDeleted;
     }
+  } else if (channel->isNoneEvent()) {
+    update(EPOLL_CTL_DEL, channel);
+    e.state = kDeleted;
+    e.events = 0;
+  } else if (events != e.events) {
+    update(EPOLL_CTL_MOD, channel);
+    e.events = events;
   }
 }
 
 void EPollPoller::removeChannel(Channel *channel) {
   LOG_TRACE << "func=" << __FUNCTION__ << ",fd=" << channel->fd();
   int fd = channel->fd();
-  channels_.erase(fd);
-
-  int index = channel->index();
-  if (index == kAdded) {
+  ChannelEntry *e = findEntry(fd);
+  if (e == nullptr || e->channel != channel) {
+    return;
+  }
+  if (e->state == kAdded) {
     update(EPOLL_CTL_DEL, channel);
   }
-  channel->set_index(kNew);
+  eraseEntry(fd);
 }
 
 void EPollPoller::fillActiveChannels(int numEvents,
@@ -96,6 +95,7 @@ void EPollPoller::fillActiveChannels(int numEvents,
 }
 
 void EPollPoller::update(int operation, Channel *channel) {
+  countInterestUpdate();
   epoll_event event;
   memset(&event, 0, sizeof(event));
   int fd = channel->fd();
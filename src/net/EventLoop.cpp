@@ -1,9 +1,15 @@
 #include "include/EventLoop.h"
 
+#include <sched.h>
 #include <sys/eventfd.h>
+#include <time.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <cstdio>
 #include <cstring>
+#include <mutex>
+#include <vector>
 
 #include "../base/include/Logging.h"
 #include "include/Channel.h"
@@ -17,6 +23,103 @@ thread_local EventLoop *t_loopInThisThread = nullptr;
 
 const int kPollTimeMs = 10000;
 
+// 统计用的纳秒时钟，vDSO 实现不进入内核
+static int64_t nowNs() {
+  struct timespec ts;
+  ::clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000 * 1000 * 1000 + ts.tv_nsec;
+}
+
+// recentBusyRatio 的统计窗口
+const int64_t kBusyWindowNs = 10 * 1000 * 1000;
+
+// 单个投递线程已归还、尚未取用的节点上限，超出后执行完的节点直接释放
+const size_t kMaxCachedNodes = 16 * 1024;
+
+// 每个投递线程一个节点池。各 loop 执行完任务后把节点归还到 returned，
+// 只有持有该池的线程取出，returned 只有一个消费者
+struct EventLoop::NodePool {
+  base::MpscQueue<PendingFunctor> returned;
+  std::atomic<size_t> numReturned{0};
+  // 以下只由持有该池的线程访问
+  PendingFunctor *cache = nullptr;
+};
+
+// 线程退出时把节点池留给之后的线程，仍在途中的节点照常归还，池本身不释放
+struct EventLoop::NodeCache {
+  NodeCache() {
+    std::lock_guard<std::mutex> lock(idleMutex());
+    if (idlePools().empty()) {
+      pool = new NodePool;
+    } else {
+      pool = idlePools().back();
+      idlePools().pop_back();
+    }
+  }
+  ~NodeCache() {
+    std::lock_guard<std::mutex> lock(idleMutex());
+    idlePools().push_back(pool);
+  }
+
+  // 其他线程可能在静态对象析构后退出，两者都不析构
+  static std::mutex &idleMutex() {
+    static std::mutex *mutex = new std::mutex;
+    return *mutex;
+  }
+  static std::vector<NodePool *> &idlePools() {
+    static std::vector<NodePool *> *pools = new std::vector<NodePool *>;
+    return *pools;
+  }
+
+  NodePool *pool;
+};
+
+EventLoop::PendingFunctor *EventLoop::newNode(Functor &&cb) {
+  static thread_local NodeCache cache;
+  NodePool *pool = cache.pool;
+  if (!pool->cache && !pool->returned.empty()) {
+    size_t count = 0;
+    pool->cache = pool->returned.popAll(&count);
+    pool->numReturned.fetch_sub(count, std::memory_order_relaxed);
+  }
+
+  PendingFunctor *node = pool->cache;
+  if (node) {
+    pool->cache = node->next;
+    node->next = nullptr;
+    node->functor = std::move(cb);
+  } else {
+    node = new PendingFunctor(std::move(cb), pool);
+  }
+  return node;
+}
+
+// 连续来自同一线程的节点整段归还，只投递任务的线程通常只有一段
+void EventLoop::recycleNodes(PendingFunctor *node) {
+  while (node) {
+    NodePool *pool = node->pool;
+    PendingFunctor *first = node;
+    PendingFunctor *last = node;
+    size_t count = 1;
+    for (node = node->next; node && node->pool == pool; node = node->next) {
+      last = node;
+      ++count;
+    }
+    if (pool->numReturned.load(std::memory_order_relaxed) + count >
+        kMaxCachedNodes) {
+      last->next = nullptr;
+      while (first) {
+        PendingFunctor *next = first->next;
+        delete first;
+        first = next;
+      }
+      continue;
+    }
+    pool->numReturned.fetch_add(count, std::memory_order_relaxed);
+    pool->returned.pushChain(first, last);
+  }
+}
+
 static int createEvent() {
   int evtfd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
   if (evtfd < 0) {
@@ -31,12 +134,27 @@ unsigned long EventLoop::get_thread_id() {
   return id;
 }
 
-EventLoop::EventLoop()
+EventLoop::EventLoop() : EventLoop(PollerBackend::kDefault) {}
+
+EventLoop::EventLoop(PollerBackend backend)
     : looping_(false),
       quit_(false),
       callingPendingFunctors_(false),
+      wakeupPending_(false),
       threadId_(std::this_thread::get_id()),
-      poller_(Poller::newDefaultPoll(this)),
+      poller_(Poller::newPoller(this, backend)),
+      busyPollMaxUs_(0),
+      busyPollSocketUs_(0),
+      avgEventGapUs_(0),
+      lastEventUs_(0),
+      spinUntilUs_(0),
+      lazyChannelUpdates_(false),
+      iterations_(0),
+      numConnections_(0),
+      busyWindowStartNs_(nowNs()),
+      busyWindowNs_(0),
+      recentBusy_(0),
+      recentBusyUpdateNs_(busyWindowStartNs_),
       wakeupFd_(createEvent()),
       wakeupChannel_(new Channel(this, wakeupFd_)),
       timerQueue_(new TimerQueue(this)) {
@@ -56,6 +174,13 @@ EventLoop::~EventLoop() {
   wakeupChannel_->remove();
   ::close(wakeupFd_);
   t_loopInThisThread = nullptr;
+
+  PendingFunctor *node = pendingFunctors_.popAll();
+  while (node) {
+    PendingFunctor *next = node->next;
+    delete node;
+    node = next;
+  }
 }
 
 void EventLoop::handleRead() {
@@ -70,21 +195,85 @@ void EventLoop::loop() {
   looping_.store(true);
   quit_.store(false);
 
+  int64_t pollStart = nowNs();
   while (!quit_.load()) {
     activeChannels_.clear();
-    pollReturnTime_ = poller_->poll(kPollTimeMs, &activeChannels_);
+    if (!dirtyChannels_.empty()) {
+      applyChannelUpdates();
+    }
+    pollReturnTime_ = poller_->poll(pollTimeoutMs(), &activeChannels_);
+    pollReturnMonotonic_ = Timestamp::monotonic();
+    int64_t pollEnd = nowNs();
+    if (busyPollMaxUs_ > 0 && !activeChannels_.empty()) {
+      updateSpinWindow();
+    }
 
     for (Channel *channel : activeChannels_) {
       LOG_TRACE << "EventLoop::loop get in channelHandle fd=" << channel->fd();
       channel->handleEvent(pollReturnTime_);
     }
-
-    doPendingFunctors();
+    int64_t handleEnd = nowNs();
+
+    size_t functors = doPendingFunctors();
+    int64_t functorsEnd = nowNs();
+
+    iterations_.store(iterations_.load(std::memory_order_relaxed) + 1,
+                      std::memory_order_relaxed);
+    pollWaitNs_.record(pollEnd - pollStart);
+    activeChannelsHist_.record(activeChannels_.size());
+    handleEventsNs_.record(handleEnd - pollEnd);
+    if (functors > 0) {
+      pendingFunctorsHist_.record(functors);
+      pendingFunctorsNs_.record(functorsEnd - handleEnd);
+    }
+    updateRecentBusy(functorsEnd - pollEnd, functorsEnd);
+    pollStart = functorsEnd;
   }
 
   looping_.store(false);
 }
 
+void EventLoop::setBusyPoll(int maxSpinUs, int socketBusyPollUs) {
+  assertInLoopThread();
+  // 只能在一个 CPU 上运行时，自旋只会推迟产生事件的线程
+  cpu_set_t cpus;
+  if (maxSpinUs > 0 && ::sched_getaffinity(0, sizeof(cpus), &cpus) == 0 &&
+      CPU_COUNT(&cpus) <= 1) {
+    LOG_WARN << "EventLoop::setBusyPoll ignored on a single CPU";
+    maxSpinUs = 0;
+  }
+  busyPollMaxUs_ = maxSpinUs > 0 ? maxSpinUs : 0;
+  busyPollSocketUs_ = socketBusyPollUs > 0 ? socketBusyPollUs : 0;
+  avgEventGapUs_ = busyPollMaxUs_;
+  spinUntilUs_ = 0;
+}
+
+int EventLoop::pollTimeoutMs() const {
+  if (busyPollMaxUs_ > 0 &&
+      pollReturnMonotonic_.microSecondsSinceEpoch() < spinUntilUs_) {
+    return 0;
+  }
+  return kPollTimeMs;
+}
+
+// 窗口取平均事件间隔的两倍，下一个事件大概率在自旋期间到达；
+// 平均间隔超过上限时自旋多半落空，直接阻塞
+void EventLoop::updateSpinWindow() {
+  int64_t now = pollReturnMonotonic_.microSecondsSinceEpoch();
+  if (lastEventUs_ > 0) {
+    double gap = static_cast<double>(now - lastEventUs_);
+    avgEventGapUs_ += (gap - avgEventGapUs_) / 8;
+  }
+  lastEventUs_ = now;
+
+  int64_t window = 0;
+  if (avgEventGapUs_ <= busyPollMaxUs_) {
+    window = std::min<int64_t>(busyPollMaxUs_,
+                               static_cast<int64_t>(avgEventGapUs_ * 2) + 1);
+  }
+  spinUntilUs_ = now + window;
+}
+
 void EventLoop::quit() {
   quit_.store(true);
 
@@ -99,33 +288,54 @@ void EventLoop::runInLoop(Functor cb) {
   if (isInLoopThread()) {
     cb();
   } else {
-    queueInLoop(cb);
+    queueInLoop(std::move(cb));
   }
 }
 
 void EventLoop::queueInLoop(Functor cb) {
-  {
-    std::lock_guard<std::mutex> lg(mutex_);
-    pendingFunctors_.push_back(cb);
+  pendingFunctors_.push(newNode(std::move(cb)));
+  wakeupIfNeeded();
+}
+
+void EventLoop::queueInLoop(std::vector<Functor> cbs) {
+  if (cbs.empty()) {
+    return;
   }
+  PendingFunctor *oldest = newNode(std::move(cbs.front()));
+  PendingFunctor *newest = oldest;
+  for (size_t i = 1; i < cbs.size(); ++i) {
+    PendingFunctor *node = newNode(std::move(cbs[i]));
+    node->next = newest;
+    newest = node;
+  }
+  pendingFunctors_.pushChain(newest, oldest);
+  wakeupIfNeeded();
+}
 
+void EventLoop::wakeupIfNeeded() {
   if (!isInLoopThread() || callingPendingFunctors_.load()) {
-    wakeup();
+    if (!wakeupPending_.exchange(true)) {
+      wakeup();
+    }
   }
 }
 
 TimerId EventLoop::runAt(Timestamp time, TimerCallback cb) {
-  return timerQueue_->addTimer(cb, time, 0.0);
+  // 墙上时间换算为单调时间，之后的系统时间调整不再影响该定时器
+  int64_t delta =
+      time.microSecondsSinceEpoch() - Timestamp::now().microSecondsSinceEpoch();
+  Timestamp when(Timestamp::monotonic().microSecondsSinceEpoch() + delta);
+  return timerQueue_->addTimer(std::move(cb), when, 0.0);
 }
 
 TimerId EventLoop::runAfter(double delay, TimerCallback cb) {
-  Timestamp time(addTime(Timestamp::now(), delay));
-  return timerQueue_->addTimer(cb, time, 0.0);
+  Timestamp time(addTime(Timestamp::monotonic(), delay));
+  return timerQueue_->addTimer(std::move(cb), time, 0.0);
 }
 
 TimerId EventLoop::runEvery(double interval, TimerCallback cb) {
-  Timestamp time(addTime(Timestamp::now(), interval));
-  return timerQueue_->addTimer(cb, time, interval);
+  Timestamp time(addTime(Timestamp::monotonic(), interval));
+  return timerQueue_->addTimer(std::move(cb), time, interval);
 }
 
 void EventLoop::cancel(TimerId timerId) { timerQueue_->cancel(timerId); }
@@ -139,32 +349,125 @@ void EventLoop::wakeup() {
 }
 
 void EventLoop::updateChannel(Channel *channel) {
+  if (lazyChannelUpdates_) {
+    if (!channel->updatePending()) {
+      channel->setUpdatePending(true);
+      dirtyChannels_.push_back(channel);
+    }
+    return;
+  }
   poller_->updateChannel(channel);
 }
 
 void EventLoop::removeChannel(Channel *channel) {
+  // Channel 即将析构，从待提交列表中摘除
+  if (channel->updatePending()) {
+    channel->setUpdatePending(false);
+    std::replace(dirtyChannels_.begin(), dirtyChannels_.end(), channel,
+                 static_cast<Channel *>(nullptr));
+  }
   poller_->removeChannel(channel);
 }
 
 bool EventLoop::hasChannel(Channel *channel) {
-  return poller_->hasChannel(channel);
+  return channel->updatePending() || poller_->hasChannel(channel);
 }
 
-void EventLoop::doPendingFunctors() {
-  LOG_TRACE << "EventLoop::doPendingFunctors callback";
+void EventLoop::setLazyChannelUpdates(bool on) {
+  assertInLoopThread();
+  lazyChannelUpdates_ = on;
+  if (!on) {
+    applyChannelUpdates();
+  }
+}
 
-  std::vector<Functor> functors;
-  callingPendingFunctors_.store(true);
+// Poller 会比较上次提交的事件，最终结果没有变化的 Channel 不产生系统调用
+void EventLoop::applyChannelUpdates() {
+  for (Channel *channel : dirtyChannels_) {
+    if (channel) {
+      channel->setUpdatePending(false);
+      poller_->updateChannel(channel);
+    }
+  }
+  dirtyChannels_.clear();
+}
 
-  {
-    std::lock_guard<std::mutex> lg(mutex_);
-    functors.swap(pendingFunctors_);
+void EventLoop::updateRecentBusy(int64_t busyNs, int64_t now) {
+  busyWindowNs_ += busyNs;
+  int64_t elapsed = now - busyWindowStartNs_;
+  if (elapsed < kBusyWindowNs) {
+    return;
   }
+  double ratio = std::min(1.0, static_cast<double>(busyWindowNs_) / elapsed);
+  recentBusy_.store(0.5 * recentBusy_.load(std::memory_order_relaxed) +
+                        0.5 * ratio,
+                    std::memory_order_relaxed);
+  recentBusyUpdateNs_.store(now, std::memory_order_relaxed);
+  busyWindowStartNs_ = now;
+  busyWindowNs_ = 0;
+}
 
-  for (const Functor &functor : functors) {
-    functor();
+// 阻塞在 poll 中的 loop 不会更新，按距上次更新的空闲时间折算
+double EventLoop::recentBusyRatio() const {
+  double busy = recentBusy_.load(std::memory_order_relaxed);
+  int64_t idle =
+      nowNs() - recentBusyUpdateNs_.load(std::memory_order_relaxed);
+  if (idle > kBusyWindowNs) {
+    busy = busy * kBusyWindowNs / idle;
+  }
+  return busy;
+}
+
+EventLoop::Stats EventLoop::stats() const {
+  Stats stats;
+  stats.iterations = iterations_.load(std::memory_order_relaxed);
+  stats.pollWait = pollWaitNs_.snapshot();
+  stats.activeChannels = activeChannelsHist_.snapshot();
+  stats.handleEvents = handleEventsNs_.snapshot();
+  stats.pendingFunctors = pendingFunctorsHist_.snapshot();
+  stats.pendingFunctorsTime = pendingFunctorsNs_.snapshot();
+  stats.interestUpdates = poller_->numInterestUpdates();
+  return stats;
+}
+
+double EventLoop::Stats::busyRatio() const {
+  double busy = static_cast<double>(handleEvents.sum) + pendingFunctorsTime.sum;
+  double total = busy + pollWait.sum;
+  return total > 0 ? busy / total : 0;
+}
+
+std::string EventLoop::Stats::toString() const {
+  char buf[128];
+  snprintf(buf, sizeof(buf), "iterations=%llu busy=%.3f interestUpdates=%llu",
+           static_cast<unsigned long long>(iterations), busyRatio(),
+           static_cast<unsigned long long>(interestUpdates));
+  std::string result(buf);
+  result += "\n  pollWait(ns)        " + pollWait.toString();
+  result += "\n  activeChannels      " + activeChannels.toString();
+  result += "\n  handleEvents(ns)    " + handleEvents.toString();
+  result += "\n  pendingFunctors     " + pendingFunctors.toString();
+  result += "\n  pendingFunctors(ns) " + pendingFunctorsTime.toString();
+  return result;
+}
+
+size_t EventLoop::doPendingFunctors() {
+  LOG_TRACE << "EventLoop::doPendingFunctors callback";
+
+  callingPendingFunctors_.store(true);
+  // 先清除标记再取队列，之后入队的投递会重新唤醒
+  wakeupPending_.store(false);
+  PendingFunctor *first = pendingFunctors_.popAll();
+  size_t count = 0;
+
+  for (PendingFunctor *node = first; node; node = node->next) {
+    node->functor();
+    // 立即释放任务持有的资源，例如 TcpConnectionPtr
+    node->functor = nullptr;
+    ++count;
   }
+  recycleNodes(first);
   callingPendingFunctors_.store(false);
+  return count;
 }
 
 void EventLoop::abortNotInLoopThread() {
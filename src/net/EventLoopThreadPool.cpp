@@ -1,25 +1,136 @@
 #include "include/EventLoopThreadPool.h"
 
+#include <algorithm>
+
+#include "../base/include/CpuTopology.h"
+#include "../base/include/Logging.h"
+#include "include/EventLoop.h"
 #include "include/EventLoopThread.h"
+#include "include/InetAddress.h"
 
 using namespace TinyWeb::net;
+using namespace TinyWeb::base;
+
+namespace {
+const int kVirtualNodes = 128;
+
+// FNV-1a 后再做一次 murmur3 的 fmix32，使相邻的输入也分散开
+uint32_t hash32(const void *data, size_t len) {
+  const unsigned char *p = static_cast<const unsigned char *>(data);
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < len; ++i) {
+    h = (h ^ p[i]) * 16777619u;
+  }
+  h ^= h >> 16;
+  h *= 0x85ebca6bu;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35u;
+  h ^= h >> 16;
+  return h;
+}
+}  // namespace
 
 EventLoopThreadPool::EventLoopThreadPool(EventLoop *baseLoop,
                                          const std::string &nameArg)
     : baseLoop_(baseLoop), name_(nameArg) {}
 
+EventLoopThreadPool::LoopOptions *EventLoopThreadPool::loopOptions(
+    int loopIndex) {
+  if (loopIndex < 0) {
+    return nullptr;
+  }
+  if (static_cast<size_t>(loopIndex) >= loopOptions_.size()) {
+    loopOptions_.resize(loopIndex + 1);
+  }
+  return &loopOptions_[loopIndex];
+}
+
+void EventLoopThreadPool::setBusyPoll(int loopIndex, int maxSpinUs,
+                                      int socketBusyPollUs) {
+  LoopOptions *options = loopOptions(loopIndex);
+  if (options) {
+    options->maxSpinUs = maxSpinUs;
+    options->socketBusyPollUs = socketBusyPollUs;
+  }
+}
+
+void EventLoopThreadPool::setThreadAffinity(int loopIndex,
+                                            const std::vector<int> &cpus) {
+  LoopOptions *options = loopOptions(loopIndex);
+  if (options) {
+    options->cpus = cpus;
+  }
+}
+
 void EventLoopThreadPool::start(const ThreadInitCallback &cb) {
   started_ = true;
 
+  const CpuTopology &topology = CpuTopology::instance();
+  std::vector<int> spread;
+  if (autoAffinity_ && numThread_ > 0) {
+    spread = topology.spreadOrder();
+  }
+  size_t nextSpread = 0;
+
   for (int i = 0; i < numThread_; i++) {
     std::string name = name_ + std::to_string(i);
-    EventLoopThread *t = new EventLoopThread(cb, name);
+    LoopOptions options;
+    if (static_cast<size_t>(i) < loopOptions_.size()) {
+      options = loopOptions_[i];
+    }
+    if (options.cpus.empty() && !spread.empty()) {
+      options.cpus.push_back(spread[nextSpread++ % spread.size()]);
+    }
+    // 所有 CPU 在同一节点时才设置内存策略
+    int node = -1;
+    for (int cpu : options.cpus) {
+      int n = topology.nodeOf(cpu);
+      node = (node == -1 || node == n) ? n : -2;
+    }
+
+    // 在 loop 线程中开始循环之前设置
+    ThreadInitCallback init = [cb, options, node, name](EventLoop *loop) {
+      if (!options.cpus.empty()) {
+        if (!CpuTopology::bindCurrentThread(options.cpus)) {
+          LOG_WARN << "EventLoopThreadPool: failed to pin " << name;
+        } else if (node >= 0 && CpuTopology::instance().numNodes() > 1) {
+          CpuTopology::preferNode(node);
+        }
+      }
+      if (options.maxSpinUs > 0) {
+        loop->setBusyPoll(options.maxSpinUs, options.socketBusyPollUs);
+      }
+      if (cb) {
+        cb(loop);
+      }
+    };
+    EventLoopThread *t = new EventLoopThread(init, name);
     threads_.push_back(std::unique_ptr<EventLoopThread>(t));
     loops_.push_back(t->startLoop());
+
+    for (int cpu : options.cpus) {
+      if (cpu < 0) {
+        continue;
+      }
+      if (static_cast<size_t>(cpu) >= cpuLoops_.size()) {
+        cpuLoops_.resize(cpu + 1, -1);
+      }
+      if (cpuLoops_[cpu] == -1) {
+        cpuLoops_[cpu] = i;
+      }
+    }
   }
 
-  if (numThread_ == 0 && cb) {
-    cb(baseLoop_);
+  if (numThread_ == 0) {
+    if (!loopOptions_.empty() && loopOptions_[0].maxSpinUs > 0) {
+      LoopOptions options = loopOptions_[0];
+      baseLoop_->runInLoop([this, options]() {
+        baseLoop_->setBusyPoll(options.maxSpinUs, options.socketBusyPollUs);
+      });
+    }
+    if (cb) {
+      cb(baseLoop_);
+    }
   }
 }
 
@@ -35,6 +146,108 @@ EventLoop *EventLoopThreadPool::getNextLoop() {
   return loop;
 }
 
+EventLoop *EventLoopThreadPool::getLoopForCpu(int cpu) const {
+  if (cpu < 0 || static_cast<size_t>(cpu) >= cpuLoops_.size() ||
+      cpuLoops_[cpu] == -1) {
+    return nullptr;
+  }
+  return loops_[cpuLoops_[cpu]];
+}
+
+// 连接数在 connectEstablished 时才更新，同一轮内接受的一批连接看到的计数相同；
+// 计数相同时从轮询位置开始找，避免全部落到同一个 loop
+EventLoop *EventLoopThreadPool::getLoopForPeer(const InetAddress &peerAddr) {
+  if (loops_.empty()) {
+    return baseLoop_;
+  }
+  if (placementCallback_) {
+    EventLoop *loop = placementCallback_(loops_, peerAddr);
+    if (loop) {
+      return loop;
+    }
+  }
+
+  switch (placement_) {
+    case kLeastConnections: {
+      size_t start = next_;
+      EventLoop *best = getNextLoop();
+      for (size_t i = 1; i < loops_.size(); ++i) {
+        EventLoop *loop = loops_[(start + i) % loops_.size()];
+        if (loop->numConnections() < best->numConnections()) {
+          best = loop;
+        }
+      }
+      return best;
+    }
+    case kPowerOfTwoConnections:
+    case kPowerOfTwoBusy: {
+      if (loops_.size() == 1) {
+        return loops_[0];
+      }
+      size_t a = randomIndex();
+      size_t b = randomIndex() % (loops_.size() - 1);
+      if (b >= a) {
+        ++b;
+      }
+      return lessLoaded(loops_[a], loops_[b]);
+    }
+    case kConsistentHash: {
+      if (hashRing_.empty()) {
+        buildHashRing();
+      }
+      uint32_t ip = peerAddr.getSockAddr()->sin_addr.s_addr;
+      uint32_t h = hash32(&ip, sizeof(ip));
+      auto it = std::lower_bound(
+          hashRing_.begin(), hashRing_.end(), h,
+          [](const std::pair<uint32_t, EventLoop *> &node, uint32_t value) {
+            return node.first < value;
+          });
+      return it == hashRing_.end() ? hashRing_.front().second : it->second;
+    }
+    case kRoundRobin:
+    default:
+      return getNextLoop();
+  }
+}
+
+size_t EventLoopThreadPool::randomIndex() {
+  // xorshift64，只在 baseLoop 线程中调用
+  random_ ^= random_ << 13;
+  random_ ^= random_ >> 7;
+  random_ ^= random_ << 17;
+  return static_cast<size_t>(random_ % loops_.size());
+}
+
+// 忙碌占比相差不到 5% 时视为相同，再比较连接数
+EventLoop *EventLoopThreadPool::lessLoaded(EventLoop *a, EventLoop *b) const {
+  if (placement_ == kPowerOfTwoBusy) {
+    double busyA = a->recentBusyRatio();
+    double busyB = b->recentBusyRatio();
+    if (busyA + 0.05 < busyB) {
+      return a;
+    }
+    if (busyB + 0.05 < busyA) {
+      return b;
+    }
+  }
+  return b->numConnections() < a->numConnections() ? b : a;
+}
+
+void EventLoopThreadPool::buildHashRing() {
+  hashRing_.clear();
+  for (size_t i = 0; i < loops_.size(); ++i) {
+    for (uint32_t v = 0; v < kVirtualNodes; ++v) {
+      uint32_t key[2] = {static_cast<uint32_t>(i), v};
+      hashRing_.emplace_back(hash32(key, sizeof(key)), loops_[i]);
+    }
+  }
+  std::sort(hashRing_.begin(), hashRing_.end(),
+            [](const std::pair<uint32_t, EventLoop *> &x,
+               const std::pair<uint32_t, EventLoop *> &y) {
+              return x.first < y.first;
+            });
+}
+
 std::vector<EventLoop *> EventLoopThreadPool::getAllLoops() {
   if (loops_.empty()) {
     return std::vector<EventLoop *>{baseLoop_};
@@ -0,0 +1,314 @@
+#include "include/IoUringPoller.h"
+
+#ifdef TINYWEB_HAVE_IO_URING
+
+#include <endian.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "../base/include/Logging.h"
+#include "include/Channel.h"
+
+using namespace TinyWeb::net;
+using namespace TinyWeb::base;
+
+// 撤销请求自身的完成事件不需要处理
+constexpr uint64_t kIgnoreToken = 0;
+
+namespace {
+int ioUringSetup(unsigned entries, io_uring_params *params) {
+  return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+int ioUringEnter(int fd, unsigned toSubmit, unsigned minComplete,
+                 unsigned flags, const void *arg, size_t argSize) {
+  return static_cast<int>(::syscall(__NR_io_uring_enter, fd, toSubmit,
+                                    minComplete, flags, arg, argSize));
+}
+}  // namespace
+
+bool IoUringPoller::isSupported() {
+  static const bool supported = []() {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int fd = ioUringSetup(4, &params);
+    if (fd < 0) {
+      return false;
+    }
+    ::close(fd);
+    return (params.features & IORING_FEAT_EXT_ARG) != 0;
+  }();
+  return supported;
+}
+
+IoUringPoller::IoUringPoller(EventLoop *loop)
+    : Poller(loop),
+      ringFd_(-1),
+      sqRing_(MAP_FAILED),
+      sqRingSize_(0),
+      cqRing_(MAP_FAILED),
+      cqRingSize_(0),
+      sqes_(static_cast<io_uring_sqe *>(MAP_FAILED)),
+      sqesSize_(0),
+      pending_(0),
+      nextGeneration_(1) {
+  unsigned flags = 0;
+#if defined(IORING_SETUP_SINGLE_ISSUER) && defined(IORING_SETUP_DEFER_TASKRUN)
+  // 只有所属的 loop 线程提交请求，完成事件也只在等待时处理（6.1+）
+  flags = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN;
+#endif
+  if (!setup(kEntries, flags) && !setup(kEntries, 0)) {
+    LOG_FATAL << "io_uring_setup error:" << errno;
+  }
+}
+
+IoUringPoller::~IoUringPoller() {
+  if (sqes_ != MAP_FAILED) {
+    ::munmap(sqes_, sqesSize_);
+  }
+  if (cqRing_ != MAP_FAILED && cqRing_ != sqRing_) {
+    ::munmap(cqRing_, cqRingSize_);
+  }
+  if (sqRing_ != MAP_FAILED) {
+    ::munmap(sqRing_, sqRingSize_);
+  }
+  if (ringFd_ >= 0) {
+    ::close(ringFd_);
+  }
+}
+
+bool IoUringPoller::setup(unsigned entries, unsigned flags) {
+  memset(&params_, 0, sizeof(params_));
+  // 完成队列开大一些，同时就绪的连接较多时不必依赖内核的溢出链表
+  params_.flags = flags | IORING_SETUP_CQSIZE;
+  params_.cq_entries = entries * 4;
+  ringFd_ = ioUringSetup(entries, &params_);
+  if (ringFd_ < 0) {
+    return false;
+  }
+  if (!(params_.features & IORING_FEAT_EXT_ARG)) {
+    ::close(ringFd_);
+    ringFd_ = -1;
+    errno = ENOSYS;
+    return false;
+  }
+
+  sqRingSize_ = params_.sq_off.array + params_.sq_entries * sizeof(unsigned);
+  cqRingSize_ = params_.cq_off.cqes + params_.cq_entries * sizeof(io_uring_cqe);
+  if (params_.features & IORING_FEAT_SINGLE_MMAP) {
+    sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+  }
+  sqRing_ = ::mmap(nullptr, sqRingSize_, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_SQ_RING);
+  if (sqRing_ == MAP_FAILED) {
+    LOG_FATAL << "io_uring mmap sq ring error:" << errno;
+  }
+  if (params_.features & IORING_FEAT_SINGLE_MMAP) {
+    cqRing_ = sqRing_;
+  } else {
+    cqRing_ = ::mmap(nullptr, cqRingSize_, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_CQ_RING);
+    if (cqRing_ == MAP_FAILED) {
+      LOG_FATAL << "io_uring mmap cq ring error:" << errno;
+    }
+  }
+  sqesSize_ = params_.sq_entries * sizeof(io_uring_sqe);
+  sqes_ = static_cast<io_uring_sqe *>(
+      ::mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_SQES));
+  if (sqes_ == MAP_FAILED) {
+    LOG_FATAL << "io_uring mmap sqes error:" << errno;
+  }
+
+  char *sq = static_cast<char *>(sqRing_);
+  sqHead_ = reinterpret_cast<unsigned *>(sq + params_.sq_off.head);
+  sqTail_ = reinterpret_cast<unsigned *>(sq + params_.sq_off.tail);
+  sqMask_ = *reinterpret_cast<unsigned *>(sq + params_.sq_off.ring_mask);
+  sqArray_ = reinterpret_cast<unsigned *>(sq + params_.sq_off.array);
+  char *cq = static_cast<char *>(cqRing_);
+  cqHead_ = reinterpret_cast<unsigned *>(cq + params_.cq_off.head);
+  cqTail_ = reinterpret_cast<unsigned *>(cq + params_.cq_off.tail);
+  cqMask_ = *reinterpret_cast<unsigned *>(cq + params_.cq_off.ring_mask);
+  cqes_ = reinterpret_cast<io_uring_cqe *>(cq + params_.cq_off.cqes);
+  LOG_TRACE << "io_uring fd=" << ringFd_ << " sq=" << params_.sq_entries
+            << " cq=" << params_.cq_entries;
+  return true;
+}
+
+TinyWeb::base::Timestamp IoUringPoller::poll(int timeoutMs,
+                                             ChannelList *activeChannels) {
+  LOG_TRACE << "func=" << __FUNCTION__
+            << " => fd total count:" << numChannels_;
+  // 上一轮触发的 poll 请求已经结束，仍有关注事件的重新挂载
+  for (int fd : fired_) {
+    ChannelEntry *e = findEntry(fd);
+    if (e) {
+      reconcile(e->channel, e);
+    }
+  }
+  fired_.clear();
+
+  int ret = submit(1, timeoutMs);
+  int saveErrno = -ret;
+  TinyWeb::base::Timestamp now(TinyWeb::base::Timestamp::now());
+
+  if (ret < 0 && saveErrno != ETIME && saveErrno != EINTR) {
+    errno = saveErrno;
+    LOG_ERROR << "IoUringPoller::poll() err";
+  }
+  fillActiveChannels(activeChannels);
+  return now;
+}
+
+void IoUringPoller::updateChannel(Channel *channel) {
+  ChannelEntry &e = entry(channel);
+  LOG_TRACE << "IoUringPoller::updateChannel fd=" << channel->fd()
+            << " events=" << channel->events() << " state=" << e.state;
+  e.state = channel->isNoneEvent() ? kDeleted : kAdded;
+  reconcile(channel, &e);
+}
+
+void IoUringPoller::removeChannel(Channel *channel) {
+  LOG_TRACE << "func=" << __FUNCTION__ << ",fd=" << channel->fd();
+  int fd = channel->fd();
+  ChannelEntry *e = findEntry(fd);
+  if (e == nullptr || e->channel != channel) {
+    return;
+  }
+  if (e->events) {
+    disarm(fd, e);
+  }
+  eraseEntry(fd);
+}
+
+io_uring_sqe *IoUringPoller::getSqe() {
+  unsigned tail = *sqTail_;
+  if (tail - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE) == params_.sq_entries) {
+    // 队列满了先提交一次，不等待完成事件
+    submit(0, 0);
+    if (tail - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE) ==
+        params_.sq_entries) {
+      LOG_FATAL << "io_uring submission queue overflow";
+    }
+  }
+  unsigned index = tail & sqMask_;
+  io_uring_sqe *sqe = &sqes_[index];
+  memset(sqe, 0, sizeof(*sqe));
+  sqArray_[index] = index;
+  __atomic_store_n(sqTail_, tail + 1, __ATOMIC_RELEASE);
+  ++pending_;
+  return sqe;
+}
+
+int IoUringPoller::submit(unsigned waitNr, int timeoutMs) {
+  int ret;
+  if (waitNr > 0) {
+    __kernel_timespec ts;
+    ts.tv_sec = timeoutMs / 1000;
+    ts.tv_nsec = (timeoutMs % 1000) * 1000 * 1000LL;
+    io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    arg.sigmask_sz = _NSIG / 8;
+    if (timeoutMs >= 0) {
+      arg.ts = reinterpret_cast<uint64_t>(&ts);
+    }
+    ret = ioUringEnter(ringFd_, pending_, waitNr,
+                       IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg,
+                       sizeof(arg));
+  } else {
+    ret = ioUringEnter(ringFd_, pending_, 0, 0, nullptr, 0);
+  }
+  if (ret < 0) {
+    return -errno;
+  }
+  // 返回值是内核取走的 sqe 数
+  pending_ -= std::min(pending_, static_cast<unsigned>(ret));
+  return ret;
+}
+
+void IoUringPoller::arm(int fd, ChannelEntry *e, int events) {
+  if (++nextGeneration_ == 0) {
+    ++nextGeneration_;
+  }
+  e->generation = nextGeneration_;
+  e->events = events;
+
+  // 一次性的 poll 请求本身就只通知一次，EPOLLET 没有意义
+  uint32_t mask = static_cast<uint32_t>(events) & ~EPOLLET;
+#if __BYTE_ORDER == __BIG_ENDIAN
+  mask = (mask << 16) | (mask >> 16);
+#endif
+  countInterestUpdate();
+  io_uring_sqe *sqe = getSqe();
+  sqe->opcode = IORING_OP_POLL_ADD;
+  sqe->fd = fd;
+  sqe->poll32_events = mask;
+  sqe->user_data = token(fd, e->generation);
+}
+
+void IoUringPoller::disarm(int fd, ChannelEntry *e) {
+  countInterestUpdate();
+  io_uring_sqe *sqe = getSqe();
+  sqe->opcode = IORING_OP_POLL_REMOVE;
+  sqe->fd = -1;
+  sqe->addr = token(fd, e->generation);
+  sqe->user_data = kIgnoreToken;
+  e->events = 0;
+}
+
+// poll 请求是一次性的，这样与 epoll 的水平触发语义一致：
+// 重新挂载时若 fd 仍然就绪，内核会立即产生完成事件
+void IoUringPoller::reconcile(Channel *channel, ChannelEntry *e) {
+  int events = channel->events();
+  if (e->events == events) {
+    return;
+  }
+  if (e->events) {
+    disarm(channel->fd(), e);
+  }
+  if (events) {
+    arm(channel->fd(), e, events);
+  }
+}
+
+void IoUringPoller::fillActiveChannels(ChannelList *activeChannels) {
+  unsigned head = *cqHead_;
+  unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+  if (head != tail) {
+    LOG_TRACE << tail - head << " events happened";
+  }
+  for (; head != tail; ++head) {
+    const io_uring_cqe &cqe = cqes_[head & cqMask_];
+    if (cqe.user_data == kIgnoreToken) {
+      continue;
+    }
+    int fd = static_cast<int>(cqe.user_data & 0xffffffff);
+    uint32_t generation = static_cast<uint32_t>(cqe.user_data >> 32);
+    ChannelEntry *e = findEntry(fd);
+    // 已撤销或已被新请求替换的 poll，丢弃
+    if (e == nullptr || e->generation != generation || e->events == 0) {
+      continue;
+    }
+    e->events = 0;
+    Channel *channel = e->channel;
+    if (cqe.res < 0) {
+      // 作为 EPOLLERR 交给 Channel 的错误处理，仍需重新挂载，否则之后不再有事件
+      LOG_EVERY_MS(ERROR, 1000)
+          << "io_uring poll fd=" << fd << " error:" << -cqe.res;
+      channel->set_revents(EPOLLERR);
+    } else {
+      channel->set_revents(cqe.res);
+    }
+    activeChannels->push_back(channel);
+    fired_.push_back(fd);
+  }
+  __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+}
+
+#endif  // TINYWEB_HAVE_IO_URING
\ No newline at end of file
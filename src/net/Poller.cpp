@@ -1,20 +1,71 @@
 #include "include/Poller.h"
 
+#include <cstdlib>
+#include <cstring>
+
+#include "../base/include/Logging.h"
 #include "include/Channel.h"
 #include "include/EpollPoller.h"
 #include "include/EventLoop.h"
+#include "include/IoUringPoller.h"
 
 using namespace TinyWeb::net;
+using namespace TinyWeb::base;
+
+// 表按块扩容，避免连接数增长时频繁搬移
+static const size_t kChannelChunk = 1024;
 
-Poller::Poller(EventLoop *loop) : ownerLoop_(loop) {}
+Poller::Poller(EventLoop *loop)
+    : numChannels_(0), numInterestUpdates_(0), ownerLoop_(loop) {}
 
 Poller *Poller::newDefaultPoll(EventLoop *loop) {
+  return newPoller(loop, PollerBackend::kDefault);
+}
+
+Poller *Poller::newPoller(EventLoop *loop, PollerBackend backend) {
+  if (backend == PollerBackend::kDefault) {
+    const char *name = ::getenv("TINYWEB_POLLER");
+    if (name && (strcmp(name, "io_uring") == 0 || strcmp(name, "uring") == 0)) {
+      backend = PollerBackend::kIoUring;
+    }
+  }
+  if (backend == PollerBackend::kIoUring) {
+#ifdef TINYWEB_HAVE_IO_URING
+    if (IoUringPoller::isSupported()) {
+      return new IoUringPoller(loop);
+    }
+#endif
+    LOG_WARN << "io_uring is not supported, fall back to epoll";
+  }
   return new EPollPoller(loop);
 }
 
 bool Poller::hasChannel(Channel *channel) const {
-  auto it = channels_.find(channel->fd());
-  return it != channels_.end() && it->second == channel;
+  size_t fd = static_cast<size_t>(channel->fd());
+  return fd < channels_.size() && channels_[fd].channel == channel;
+}
+
+Poller::ChannelEntry &Poller::entry(Channel *channel) {
+  size_t fd = static_cast<size_t>(channel->fd());
+  if (fd >= channels_.size()) {
+    channels_.resize((fd / kChannelChunk + 1) * kChannelChunk);
+  }
+  ChannelEntry &e = channels_[fd];
+  if (e.channel != channel) {
+    if (e.channel == nullptr) {
+      ++numChannels_;
+    }
+    e = ChannelEntry();
+    e.channel = channel;
+  }
+  return e;
+}
+
+void Poller::eraseEntry(int fd) {
+  if (findEntry(fd)) {
+    channels_[fd] = ChannelEntry();
+    --numChannels_;
+  }
 }
 
 Poller::~Poller() {}
\ No newline at end of file
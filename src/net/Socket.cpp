@@ -1,5 +1,6 @@
 #include "include/Socket.h"
 
+#include <linux/filter.h>
 #include <netinet/tcp.h>
 #include <sys/socket.h>
 #include <unistd.h>
@@ -37,6 +38,42 @@ int Socket::getSocketError(int sockfd) {
   }
 }
 
+bool Socket::attachReusePortCpuSteering(int groupSize) {
+#ifdef SO_ATTACH_REUSEPORT_CBPF
+  if (groupSize <= 0) {
+    errno = EINVAL;
+    return false;
+  }
+  // A = 当前 CPU; A %= groupSize; return A
+  struct sock_filter code[] = {
+      {BPF_LD | BPF_W | BPF_ABS, 0, 0,
+       static_cast<uint32_t>(SKF_AD_OFF + SKF_AD_CPU)},
+      {BPF_ALU | BPF_MOD | BPF_K, 0, 0, static_cast<uint32_t>(groupSize)},
+      {BPF_RET | BPF_A, 0, 0, 0},
+  };
+  struct sock_fprog prog;
+  prog.len = sizeof(code) / sizeof(code[0]);
+  prog.filter = code;
+  return ::setsockopt(sockfd_, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog,
+                      sizeof(prog)) == 0;
+#else
+  (void)groupSize;
+  errno = ENOPROTOOPT;
+  return false;
+#endif
+}
+
+int Socket::getIncomingCpu(int sockfd) {
+#ifdef SO_INCOMING_CPU
+  int cpu = -1;
+  socklen_t optlen = sizeof(cpu);
+  if (::getsockopt(sockfd, SOL_SOCKET, SO_INCOMING_CPU, &cpu, &optlen) == 0) {
+    return cpu;
+  }
+#endif
+  return -1;
+}
+
 bool Socket::isSelfConnect(int sockfd) {
   sockaddr_in localaddr = InetAddress::getLocalAddr(sockfd);
   sockaddr_in peeraddr = InetAddress::getPeerAddr(sockfd);
@@ -109,4 +146,14 @@ void Socket::setReusePort(bool on) {
 void Socket::setKeepAlive(bool on) {
   int optval = on ? 1 : 0;
   ::setsockopt(sockfd_, SOL_SOCKET, SO_KEEPALIVE, &optval, sizeof(optval));
+}
+
+bool Socket::setBusyPoll(int usec) {
+#ifdef SO_BUSY_POLL
+  return ::setsockopt(sockfd_, SOL_SOCKET, SO_BUSY_POLL, &usec,
+                      sizeof(usec)) == 0;
+#else
+  errno = ENOPROTOOPT;
+  return false;
+#endif
 }
\ No newline at end of file
@@ -10,6 +10,9 @@
 using namespace TinyWeb::net;
 using namespace TinyWeb::base;
 
+// 边沿触发时每个连接每轮最多读的次数，用完后让出给同一 loop 上的其他连接
+static const int kEdgeTriggeredBudget = 16;
+
 static EventLoop *CheckLoopNotNull(EventLoop *loop) {
   if (loop == nullptr) {
     LOG_FATAL << __FILE__ << ":" << __FUNCTION__ << ":" << __LINE__
@@ -25,6 +28,10 @@ TcpConnection::TcpConnection(EventLoop *loop, const std::string &nameArg,
       name_(nameArg),
       state_(kConnecting),
       reading_(true),
+      deferWrite_(false),
+      migrating_(false),
+      sendQueued_(false),
+      bytesReceived_(0),
       socket_(new Socket(sockfd)),
       channel_(new Channel(loop, sockfd)),
       localAddr_(localAddr),
@@ -46,27 +53,72 @@ TcpConnection::~TcpConnection() {
 }
 
 void TcpConnection::send(const std::string &buf) {
-  if (state_ == kConnected) {
-    if (loop_->isInLoopThread()) {
-      sendInLoop(buf.c_str(), buf.size());
-    } else {
-      loop_->runInLoop(
-          std::bind(&TcpConnection::sendInLoop, this, buf.c_str(), buf.size()));
-    }
-  }
+  send(buf.data(), buf.size());
 }
 
 void TcpConnection::send(const void *data, size_t len) {
   if (state_ == kConnected) {
-    if (loop_->isInLoopThread()) {
+    if (getLoop()->isInLoopThread()) {
       sendInLoop(data, len);
     } else {
-      loop_->runInLoop(std::bind(&TcpConnection::sendInLoop, this, data, len));
+      queueSend(data, len);
+    }
+  }
+}
+
+// 跨线程发送的数据按调用顺序追加到 pendingSend_，只投递一个任务负责写出。
+// 数据不随任务转交，迁移期间任务被转到新 loop 也不会与之后的 send 乱序
+void TcpConnection::queueSend(const void *data, size_t len) {
+  bool post = false;
+  {
+    std::lock_guard<std::mutex> lock(sendMutex_);
+    pendingSend_.append(static_cast<const char *>(data), len);
+    if (!sendQueued_.load()) {
+      sendQueued_.store(true);
+      post = true;
     }
   }
+  if (post) {
+    getLoop()->queueInLoop(
+        std::bind(&TcpConnection::flushPendingSend, shared_from_this()));
+  }
+}
+
+void TcpConnection::flushPendingSend() {
+  EventLoop *loop = getLoop();
+  if (!loop->isInLoopThread()) {
+    loop->queueInLoop(
+        std::bind(&TcpConnection::flushPendingSend, shared_from_this()));
+    return;
+  }
+  // 迁移未完成时由 attachInLoop 写出
+  if (migrating_) {
+    return;
+  }
+  std::string data;
+  {
+    std::lock_guard<std::mutex> lock(sendMutex_);
+    data.swap(pendingSend_);
+    sendQueued_.store(false);
+  }
+  if (!data.empty()) {
+    writeInLoop(data.data(), data.size());
+  }
 }
 
 void TcpConnection::sendInLoop(const void *data, size_t len) {
+  // 迁移未完成或其他线程还有未写出的数据时，排在这些数据之后
+  if (migrating_ || sendQueued_.load()) {
+    queueSend(data, len);
+    if (!migrating_) {
+      flushPendingSend();
+    }
+    return;
+  }
+  writeInLoop(data, len);
+}
+
+void TcpConnection::writeInLoop(const void *data, size_t len) {
   ssize_t nwrote = 0;
   size_t remaining = len;
   bool faultError = false;
@@ -76,12 +128,13 @@ void TcpConnection::sendInLoop(const void *data, size_t len) {
     return;
   }
 
-  if (!channel_->isWriting() && outputBuffer_.readableBytes() == 0) {
+  if (!channel_->isWriting() && outputBuffer_.readableBytes() == 0 &&
+      !deferWrite_) {
     nwrote = ::write(channel_->fd(), data, len);
     if (nwrote >= 0) {
       remaining = len - nwrote;
       if (remaining == 0 && writeCompleteCallback_) {
-        loop_->queueInLoop(
+        getLoop()->queueInLoop(
             std::bind(writeCompleteCallback_, shared_from_this()));
       }
     } else {
@@ -99,11 +152,11 @@ void TcpConnection::sendInLoop(const void *data, size_t len) {
     size_t oldLen = outputBuffer_.readableBytes();
     if (oldLen + remaining >= highWaterMark_ && oldLen < highWaterMark_ &&
         highWaterMarkCallback_) {
-      loop_->queueInLoop(std::bind(highWaterMarkCallback_, shared_from_this(),
-                                   oldLen + remaining));
+      getLoop()->queueInLoop(std::bind(highWaterMarkCallback_,
+                                       shared_from_this(), oldLen + remaining));
     }
     outputBuffer_.append((char *)data + nwrote, remaining);
-    if (!channel_->isWriting()) {
+    if (!channel_->isWriting() && !deferWrite_) {
       channel_->enabelWriting();
     }
   }
@@ -112,37 +165,171 @@ void TcpConnection::sendInLoop(const void *data, size_t len) {
 void TcpConnection::shutdown() {
   if (state_ == kConnected) {
     setState(kDisConnecting);
-    loop_->runInLoop(std::bind(&TcpConnection::shutdownInLoop, this));
+    getLoop()->runInLoop(std::bind(&TcpConnection::shutdownInLoop, this));
+  }
+}
+
+// 流水线请求的多个响应合并成一次 write，也避免小包被 Nagle 算法延迟
+void TcpConnection::flushDeferredOutput() {
+  deferWrite_ = false;
+  if (channel_->isWriting() || outputBuffer_.readableBytes() == 0) {
+    return;
+  }
+
+  int savedErrno = 0;
+  ssize_t n = outputBuffer_.writeFd(channel_->fd(), &savedErrno);
+  if (n > 0) {
+    outputBuffer_.retrieve(n);
+  } else if (savedErrno != EWOULDBLOCK) {
+    errno = savedErrno;
+    LOG_ERROR << "TcpConnection::flushDeferredOutput";
+    if (savedErrno == EPIPE || savedErrno == ECONNRESET) {
+      return;
+    }
+  }
+
+  if (outputBuffer_.readableBytes() == 0) {
+    if (writeCompleteCallback_) {
+      getLoop()->queueInLoop(
+          std::bind(writeCompleteCallback_, shared_from_this()));
+    }
+    if (state_ == kDisConnecting) {
+      shutdownInLoop();
+    }
+  } else {
+    channel_->enabelWriting();
   }
 }
 
 void TcpConnection::shutdownInLoop() {
-  if (!channel_->isWriting()) {
+  EventLoop *loop = getLoop();
+  if (!loop->isInLoopThread()) {
+    loop->runInLoop(
+        std::bind(&TcpConnection::shutdownInLoop, shared_from_this()));
+    return;
+  }
+  // 迁移完成后由 attachInLoop 处理，排队的数据要先写出
+  if (migrating_) {
+    return;
+  }
+  if (sendQueued_.load()) {
+    flushPendingSend();
+  }
+  if (!channel_->isWriting() && outputBuffer_.readableBytes() == 0) {
     socket_->shutdownWrite();
   }
 }
 
+void TcpConnection::setEdgeTriggered(bool on) {
+  channel_->setEdgeTriggered(on);
+}
+
 void TcpConnection::connectEstablished() {
   setState(kConnected);
+  getLoop()->addConnections(1);
+  if (getLoop()->busyPollSocketUs() > 0 &&
+      !socket_->setBusyPoll(getLoop()->busyPollSocketUs())) {
+    LOG_EVERY_MS(WARN, 60000) << "SO_BUSY_POLL failed, errno:" << errno;
+  }
   channel_->tie(shared_from_this());
   channel_->enableReading();
 
   connectionCallback_(shared_from_this());
 }
 
+// 排队期间连接可能已迁移，转发到当前所在的 loop；
+// 迁移未完成时等 attachInLoop 之后再执行，保证连接计数成对增减
 void TcpConnection::connectDestroyed() {
+  EventLoop *loop = getLoop();
+  if (!loop->isInLoopThread() || migrating_) {
+    loop->queueInLoop(
+        std::bind(&TcpConnection::connectDestroyed, shared_from_this()));
+    return;
+  }
   if (state_ == kConnected) {
     setState(kDisconnected);
     channel_->disableAll();
     connectionCallback_(shared_from_this());
   }
+  loop->addConnections(-1);
+  channel_->remove();
+}
+
+void TcpConnection::migrateTo(EventLoop *target) {
+  getLoop()->queueInLoop(
+      std::bind(&TcpConnection::migrateInLoop, shared_from_this(), target));
+}
+
+// 总是经 queueInLoop 在 functor 阶段执行，此时不在本连接 Channel 的回调中，
+// 可以安全地销毁旧 Channel
+void TcpConnection::migrateInLoop(EventLoop *target) {
+  EventLoop *loop = getLoop();
+  if (!loop->isInLoopThread()) {
+    loop->queueInLoop(
+        std::bind(&TcpConnection::migrateInLoop, shared_from_this(), target));
+    return;
+  }
+  if (target == nullptr || target == loop || state_ != kConnected ||
+      migrating_) {
+    return;
+  }
+
+  const bool edgeTriggered = channel_->isEdgeTriggered();
+  channel_->disableAll();
   channel_->remove();
+  loop->addConnections(-1);
+
+  // 新 Channel 只构造，在 target 线程中才注册；之前到达 target 的 send
+  // 可能先注册写事件，attachInLoop 再补上读事件
+  channel_.reset(new Channel(target, socket_->fd()));
+  channel_->setReadCallback(
+      std::bind(&TcpConnection::handleRead, this, std::placeholders::_1));
+  channel_->setWriteCallback(std::bind(&TcpConnection::handleWrite, this));
+  channel_->setCloseCallback(std::bind(&TcpConnection::handleClose, this));
+  channel_->setErrorCallback(std::bind(&TcpConnection::handleError, this));
+  channel_->setEdgeTriggered(edgeTriggered);
+  channel_->tie(shared_from_this());
+
+  migrating_ = true;
+  loop_.store(target, std::memory_order_release);
+  target->queueInLoop(
+      std::bind(&TcpConnection::attachInLoop, shared_from_this()));
+}
+
+// 注册时 fd 若已就绪会立即产生事件，边沿触发也不会漏掉迁移期间到达的数据
+void TcpConnection::attachInLoop() {
+  migrating_ = false;
+  EventLoop *loop = getLoop();
+  loop->addConnections(1);
+  if (state_ == kDisconnected) {
+    return;
+  }
+  if (loop->busyPollSocketUs() > 0) {
+    socket_->setBusyPoll(loop->busyPollSocketUs());
+  }
+  channel_->enableReading();
+  if (sendQueued_.load()) {
+    flushPendingSend();
+  }
+  if (outputBuffer_.readableBytes() > 0 && !channel_->isWriting()) {
+    channel_->enabelWriting();
+  }
+  // 迁移期间调用的 shutdown
+  if (state_ == kDisConnecting) {
+    shutdownInLoop();
+  }
 }
 
 void TcpConnection::handleRead(base::Timestamp receiveTime) {
+  if (channel_->isEdgeTriggered()) {
+    handleReadEdgeTriggered(receiveTime);
+    return;
+  }
+
   int savedErrno = 0;
   ssize_t n = inputBuffer_.readFd(channel_->fd(), &savedErrno);
   if (n > 0) {
+    addBytesReceived(n);
     messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
   } else if (n == 0) {
     handleClose();
@@ -153,16 +340,60 @@ void TcpConnection::handleRead(base::Timestamp receiveTime) {
   }
 }
 
+// 读到 EAGAIN 或 0 为止，期间收到的数据合并成一次 messageCallback_。
+// 不能以读不满判断内核缓冲区已空：readFd 在缓冲区足够大时不使用栈上的
+// 额外缓冲，读满也可能小于预估的容量，提前停止后不会再有新的边沿
+void TcpConnection::handleReadEdgeTriggered(base::Timestamp receiveTime) {
+  int savedErrno = 0;
+  ssize_t n = 0;
+  size_t total = 0;
+  bool drained = false;
+  for (int i = 0; i < kEdgeTriggeredBudget; ++i) {
+    n = inputBuffer_.readFd(channel_->fd(), &savedErrno);
+    if (n <= 0) {
+      drained = true;
+      break;
+    }
+    total += n;
+  }
+
+  if (total > 0) {
+    addBytesReceived(total);
+    deferWrite_ = true;
+    messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
+    flushDeferredOutput();
+  }
+  if (n == 0) {
+    handleClose();
+  } else if (n < 0 && savedErrno != EAGAIN && savedErrno != EWOULDBLOCK) {
+    errno = savedErrno;
+    LOG_ERROR << "TcpConnection::handleRead";
+    handleError();
+  } else if (!drained && state_ != kDisconnected) {
+    // 预算用完时不会再有新的边沿，排到本轮末尾继续读
+    TcpConnectionPtr conn(shared_from_this());
+    getLoop()->queueInLoop([conn, receiveTime]() {
+      // 期间被迁移时新 loop 注册后会重新收到读事件
+      if (conn->getLoop()->isInLoopThread() &&
+          conn->state_ != kDisconnected) {
+        conn->handleReadEdgeTriggered(receiveTime);
+      }
+    });
+  }
+}
+
 void TcpConnection::handleWrite() {
   if (channel_->isWriting()) {
     int savedErrno = 0;
+    // 一次写出全部待发数据，没写完说明发送缓冲区已满，边沿触发时也会在
+    // 缓冲区腾出空间后再次收到 EPOLLOUT
     ssize_t n = outputBuffer_.writeFd(channel_->fd(), &savedErrno);
     if (n > 0) {
       outputBuffer_.retrieve(n);
       if (outputBuffer_.readableBytes() == 0) {
         channel_->disableWriting();
         if (writeCompleteCallback_) {
-          loop_->queueInLoop(
+          getLoop()->queueInLoop(
               std::bind(writeCompleteCallback_, shared_from_this()));
         }
         if (state_ == kDisConnecting) {
@@ -170,7 +401,8 @@ void TcpConnection::handleWrite() {
         }
       }
     } else {
-      LOG_ERROR << "TcpConnection::handleWrite with errno:" << savedErrno;
+      LOG_EVERY_MS(ERROR, 1000)
+          << "TcpConnection::handleWrite with errno:" << savedErrno;
     }
   } else {
     LOG_ERROR << "TcpConnection fd =" << channel_->fd()
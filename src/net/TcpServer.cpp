@@ -1,7 +1,11 @@
 #include "include/TcpServer.h"
 
+#include <algorithm>
+#include <future>
+
 #include "../base/include/Logging.h"
 #include "include/EventLoop.h"
+#include "include/Socket.h"
 #include "include/TcpConnection.h"
 
 using namespace TinyWeb::net;
@@ -20,11 +24,20 @@ TcpServer::TcpServer(EventLoop *loop, const InetAddress &listenAddr,
     : loop_(CheckLoopNotNull(loop)),
       ipPort_(listenAddr.toIpPort()),
       name_(nameArg),
-      acceptor_(new Acceptor(loop, listenAddr, option == kReusePort)),
+      listenAddr_(listenAddr),
+      option_(option),
+      acceptor_(new Acceptor(loop, listenAddr,
+                             option == kReusePort ||
+                                 option == kReusePortPerLoop)),
       threadPool_(new EventLoopThreadPool(loop, name_)),
       connectionCallback_(),
       messageCallback_(),
       nextConnId_(1),
+      edgeTriggered_(false),
+      incomingCpuRouting_(false),
+      reusePortCpuSteering_(false),
+      rebalanceInterval_(0),
+      rebalanceThreshold_(0.7),
       started_(0) {
   acceptor_->setNewConnectionCallback(std::bind(&TcpServer::newConnection, this,
                                                 std::placeholders::_1,
@@ -32,6 +45,19 @@ TcpServer::TcpServer(EventLoop *loop, const InetAddress &listenAddr,
 }
 
 TcpServer::~TcpServer() {
+  if (rebalanceInterval_ > 0) {
+    loop_->cancel(rebalanceTimer_);
+  }
+  // Acceptor 需在所属 loop 中析构，等它完成后才能释放 this
+  for (std::unique_ptr<Acceptor> &acceptor : loopAcceptors_) {
+    Acceptor *a = acceptor.release();
+    std::promise<void> done;
+    a->getLoop()->runInLoop([a, &done]() {
+      delete a;
+      done.set_value();
+    });
+    done.get_future().wait();
+  }
   for (auto &item : connections_) {
     TcpConnectionPtr conn(item.second);
     item.second.reset();
@@ -47,15 +73,156 @@ void TcpServer::setThreadNum(int numThreads) {
 void TcpServer::start() {
   if (started_++ == 0) {
     threadPool_->start(threadInitCallback_);
-    loop_->runInLoop(std::bind(&Acceptor::listen, acceptor_.get()));
+    std::vector<EventLoop *> loops = threadPool_->getAllLoops();
+    if ((option_ == kReusePortPerLoop || option_ == kExclusiveAccept) &&
+        loops.front() != loop_) {
+      startLoopAcceptors();
+    } else {
+      loop_->runInLoop(std::bind(&Acceptor::listen, acceptor_.get()));
+    }
+    if (rebalanceInterval_ > 0) {
+      rebalanceTimer_ = loop_->runEvery(
+          rebalanceInterval_, std::bind(&TcpServer::rebalance, this));
+    }
+  }
+}
+
+void TcpServer::rebalance() {
+  std::vector<EventLoop *> loops = threadPool_->getAllLoops();
+  EventLoop *hot = loops.front();
+  EventLoop *cold = loops.front();
+  double hotBusy = hot->recentBusyRatio();
+  double coldBusy = hotBusy;
+  for (size_t i = 1; i < loops.size(); ++i) {
+    double busy = loops[i]->recentBusyRatio();
+    if (busy > hotBusy) {
+      hot = loops[i];
+      hotBusy = busy;
+    }
+    if (busy < coldBusy) {
+      cold = loops[i];
+      coldBusy = busy;
+    }
+  }
+
+  // 统计最忙的 loop 上每个连接在上个周期读到的字节数
+  std::unordered_map<std::string, uint64_t> last;
+  last.swap(lastBytesReceived_);
+  std::vector<std::pair<uint64_t, TcpConnectionPtr>> hotConns;
+  uint64_t hotBytes = 0;
+  for (auto &item : connections_) {
+    uint64_t bytes = item.second->bytesReceived();
+    lastBytesReceived_[item.first] = bytes;
+    if (item.second->getLoop() == hot) {
+      auto it = last.find(item.first);
+      uint64_t delta = it == last.end() ? bytes : bytes - it->second;
+      hotConns.emplace_back(delta, item.second);
+      hotBytes += delta;
+    }
+  }
+  if (hot == cold || hotBusy < rebalanceThreshold_ ||
+      hotBusy - coldBusy < rebalanceThreshold_ / 2 || hotBytes == 0) {
+    return;
+  }
+
+  // 假设忙碌时间与读到的字节数成正比，估算迁移后两个 loop 的忙碌占比
+  TcpConnectionPtr best;
+  double bestBusy = hotBusy * 0.9;
+  for (auto &item : hotConns) {
+    double share = static_cast<double>(item.first) / hotBytes;
+    double busy =
+        std::max(hotBusy * (1 - share), coldBusy + hotBusy * share);
+    if (item.first > 0 && busy < bestBusy) {
+      best = item.second;
+      bestBusy = busy;
+    }
+  }
+  if (best) {
+    LOG_INFO << "TcpServer::rebalance [" << name_ << "] migrate "
+             << best->name() << " busy " << hotBusy << " -> " << coldBusy;
+    best->migrateTo(cold);
+  }
+}
+
+void TcpServer::startLoopAcceptors() {
+  std::vector<EventLoop *> loops = threadPool_->getAllLoops();
+  if (option_ == kExclusiveAccept) {
+    acceptor_->listenSocket();
+    for (EventLoop *ioLoop : loops) {
+      loopAcceptors_.emplace_back(new Acceptor(ioLoop, acceptor_.get()));
+    }
+  } else {
+    // CBPF 程序返回 CPU % n，第 k 个套接字尽量给绑定在 CPU k 上的 loop
+    std::vector<EventLoop *> ordered(loops.size(), nullptr);
+    for (size_t k = 0; k < ordered.size(); ++k) {
+      EventLoop *ioLoop = threadPool_->getLoopForCpu(static_cast<int>(k));
+      if (ioLoop &&
+          std::find(ordered.begin(), ordered.end(), ioLoop) == ordered.end()) {
+        ordered[k] = ioLoop;
+      }
+    }
+    for (EventLoop *ioLoop : loops) {
+      if (std::find(ordered.begin(), ordered.end(), ioLoop) == ordered.end()) {
+        *std::find(ordered.begin(), ordered.end(), nullptr) = ioLoop;
+      }
+    }
+    // 组内编号按 listen 的先后分配，在这里依次 listen 而不是在各自的线程中
+    for (EventLoop *ioLoop : ordered) {
+      loopAcceptors_.emplace_back(new Acceptor(ioLoop, listenAddr_, true));
+      loopAcceptors_.back()->listenSocket();
+    }
+    if (reusePortCpuSteering_ &&
+        !loopAcceptors_.front()->attachReusePortCpuSteering(
+            static_cast<int>(loopAcceptors_.size()))) {
+      LOG_ERROR << "TcpServer::start [" << name_
+                << "] attach SO_REUSEPORT CBPF error:" << errno;
+    }
+  }
+
+  for (std::unique_ptr<Acceptor> &acceptor : loopAcceptors_) {
+    EventLoop *ioLoop = acceptor->getLoop();
+    acceptor->setNewConnectionCallback(
+        std::bind(&TcpServer::newConnectionInLoop, this, ioLoop,
+                  std::placeholders::_1, std::placeholders::_2));
+    ioLoop->runInLoop(std::bind(&Acceptor::listen, acceptor.get()));
   }
 }
 
 void TcpServer::newConnection(int sockfd, const InetAddress &peerAddr) {
-  EventLoop *ioLoop = threadPool_->getNextLoop();
+  EventLoop *ioLoop = nullptr;
+  if (incomingCpuRouting_) {
+    ioLoop = threadPool_->getLoopForCpu(Socket::getIncomingCpu(sockfd));
+  }
+  if (ioLoop == nullptr) {
+    ioLoop = threadPool_->getLoopForPeer(peerAddr);
+  }
+
+  // I/O 线程绑定了 CPU 时在该线程中创建连接对象和缓冲区，
+  // 使其分配在 loop 所在的 NUMA 节点
+  if (threadPool_->pinned() && ioLoop != loop_) {
+    ioLoop->runInLoop(std::bind(&TcpServer::newConnectionInLoop, this, ioLoop,
+                                sockfd, peerAddr));
+    return;
+  }
+
+  TcpConnectionPtr conn = createConnection(ioLoop, sockfd, peerAddr);
+  connections_[conn->name()] = conn;
+  ioLoop->runInLoop(std::bind(&TcpServer::establishConnection, this, conn));
+}
+
+// 连接表仍由 loop_ 维护，登记先于 connectEstablished 入队，
+// 必然早于之后的 removeConnection
+void TcpServer::newConnectionInLoop(EventLoop *ioLoop, int sockfd,
+                                    const InetAddress &peerAddr) {
+  TcpConnectionPtr conn = createConnection(ioLoop, sockfd, peerAddr);
+  loop_->runInLoop([this, conn]() { connections_[conn->name()] = conn; });
+  establishConnection(conn);
+}
+
+TcpConnectionPtr TcpServer::createConnection(EventLoop *ioLoop, int sockfd,
+                                             const InetAddress &peerAddr) {
   char buf[64] = {0};
-  snprintf(buf, sizeof(buf), "-%s#%d", ipPort_.c_str(), nextConnId_);
-  ++nextConnId_;
+  snprintf(buf, sizeof(buf), "-%s#%d", ipPort_.c_str(), nextConnId_++);
   std::string connName = name_ + buf;
 
   LOG_TRACE << "TcpServer::newConnection [" << name_ << "] - new connection ["
@@ -69,17 +236,19 @@ void TcpServer::newConnection(int sockfd, const InetAddress &peerAddr) {
   }
 
   InetAddress localAddr(local);
-  TcpConnectionPtr conn(
+  return TcpConnectionPtr(
       new TcpConnection(ioLoop, connName, sockfd, localAddr, peerAddr));
-  connections_[connName] = conn;
+}
+
+void TcpServer::establishConnection(const TcpConnectionPtr &conn) {
   conn->setConnectionCallback(connectionCallback_);
   conn->setMessageCallback(messageCallback_);
   conn->setWriteCompleteCallback(writeCompleteCallback_);
+  conn->setEdgeTriggered(edgeTriggered_);
 
   conn->setCloseCallback(
       std::bind(&TcpServer::removeConnection, this, std::placeholders::_1));
-
-  ioLoop->runInLoop(std::bind(&TcpConnection::connectEstablished, conn));
+  conn->connectEstablished();
 }
 
 void TcpServer::removeConnection(const TcpConnectionPtr &conn) {
@@ -22,12 +22,10 @@ int createTimerfd() {
   return timerfd;
 }
 
-struct timespec howMuchTimeFromNow(Timestamp when) {
-  int64_t microseconds =
-      when.microSecondsSinceEpoch() - Timestamp::now().microSecondsSinceEpoch();
-  if (microseconds < 100) {
-    microseconds = 100;
-  }
+// 定时器使用 Timestamp::monotonic() 时间，与 timerfd 同为 CLOCK_MONOTONIC，
+// 直接设置绝对时间，系统时间跳变不会影响到期时刻
+struct timespec toTimespec(Timestamp when) {
+  int64_t microseconds = when.microSecondsSinceEpoch();
   struct timespec ts;
   ts.tv_sec =
       static_cast<time_t>(microseconds / Timestamp::kMicroSecondsPerSecond);
@@ -52,8 +50,9 @@ void resetTimerfd(int timerfd, Timestamp expiration) {
   struct itimerspec oldValue;
   bzero(&newValue, sizeof(newValue));
   bzero(&oldValue, sizeof(oldValue));
-  newValue.it_value = howMuchTimeFromNow(expiration);
-  int ret = ::timerfd_settime(timerfd, 0, &newValue, &oldValue);
+  newValue.it_value = toTimespec(expiration);
+  int ret =
+      ::timerfd_settime(timerfd, TFD_TIMER_ABSTIME, &newValue, &oldValue);
   if (ret) {
     LOG_ERROR << "timerfd_settime()";
   }
@@ -80,7 +79,7 @@ TimerQueue::~TimerQueue() {
 
 TimerId TimerQueue::addTimer(TimerCallback cb, Timestamp when,
                              double interval) {
-  Timer* timer = new Timer(cb, when, interval);
+  Timer* timer = new Timer(std::move(cb), when, interval);
   loop_->runInLoop(std::bind(&TimerQueue::addTimerInLoop, this, timer));
   return TimerId(timer, timer->sequence());
 }
@@ -116,7 +115,7 @@ void TimerQueue::cancelInLoop(TimerId timerId) {
 
 void TimerQueue::handleRead() {
   loop_->assertInLoopThread();
-  Timestamp now(Timestamp::now());
+  Timestamp now(loop_->pollReturnMonotonic());
   readTimerfd(timerfd_, now);
 
   std::vector<Entry> expired = getExpired(now);
@@ -37,16 +37,22 @@ void HttpServer::onMessage(const TcpConnectionPtr &conn, Buffer *buf,
                            Timestamp receiveTime) {
   std::unique_ptr<HttpContext> context(new HttpContext);
 
-  if (!context->parseRequest(buf, receiveTime)) {
-    LOG_INFO << "parseRequest failed!";
-    HttpResponse response(true);
-    response.setStatusCode(HttpResponse::k400BadRequest);
-    sendFile(HttpResponse::CODE_PATH.find(HttpResponse::k400BadRequest)->second,
-             conn, &response, Static);
-    conn->shutdown();
-  }
+  // 流水线请求可能在同一次读取中到达，逐个处理完整的请求
+  while (buf->readableBytes() > 0) {
+    if (!context->parseRequest(buf, receiveTime)) {
+      LOG_INFO << "parseRequest failed!";
+      HttpResponse response(true);
+      response.setStatusCode(HttpResponse::k400BadRequest);
+      sendFile(
+          HttpResponse::CODE_PATH.find(HttpResponse::k400BadRequest)->second,
+          conn, &response, Static);
+      conn->shutdown();
+      break;
+    }
 
-  if (context->gotAll()) {
+    if (!context->gotAll()) {
+      break;
+    }
     LOG_INFO << "parseRequest success!";
     onRequest(conn, context->request());
     context->reset();
@@ -2,6 +2,7 @@
 #define SRC_NET_INCLUDE_ACCEPTOR_H_
 
 #include <functional>
+#include <memory>
 
 #include "../../base/include/noncopyable.h"
 
@@ -18,21 +19,33 @@ class Acceptor : base::noncopyable {
 
   Acceptor(EventLoop *loop, const InetAddress &listenAddr,
            bool reuseport = true);
+  // 与 shared 共用监听套接字，以 EPOLLEXCLUSIVE 注册到 loop，
+  // 一个连接只唤醒其中一个 loop
+  Acceptor(EventLoop *loop, Acceptor *shared);
+  // 需在 loop 线程中析构
   ~Acceptor();
 
   void setNewConnectionCallback(const NewConnectionCallback &cb) {
     newConnectionCallback_ = cb;
   }
 
+  // listen(2) 并开始在 loop 中接受连接，需在 loop 线程中调用
   void listen();
+  // 只调用 listen(2)，可在任意线程中调用。SO_REUSEPORT 组内套接字的
+  // 编号按 listen 的先后分配，需要确定顺序时先依次调用它
+  void listenSocket();
+  // 为 SO_REUSEPORT 组挂载 CBPF 程序，按处理数据包的 CPU 编号对 groupSize
+  // 取模选择组内第几个套接字。需在组内所有套接字 listen 之后调用
+  bool attachReusePortCpuSteering(int groupSize);
 
   bool listenning() const { return listenning_; }
+  EventLoop *getLoop() const { return loop_; }
 
  private:
   void handleRead();
 
   EventLoop *loop_;
-  Socket *acceptSock_;
+  std::shared_ptr<Socket> acceptSock_;
   Channel *acceptChannel_;
   NewConnectionCallback newConnectionCallback_;
   bool listenning_ = false;
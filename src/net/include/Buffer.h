@@ -16,6 +16,8 @@ class Buffer : base::noncopyable {
  public:
   static const size_t kCheapPrepend = 8;
   static const size_t kInitialSize = 1024;
+  // readFd 在栈上额外提供的空间，一次最多读入 writeableBytes() + 该值
+  static const size_t kExtraReadSize = 65536;
   static const char kCRLF[];
 
   explicit Buffer(size_t initialSize = kInitialSize)
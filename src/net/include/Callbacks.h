@@ -4,6 +4,7 @@
 #include <functional>
 #include <memory>
 
+#include "../../base/include/SmallFunction.h"
 #include "../../base/include/Timestamp.h"
 
 namespace TinyWeb {
@@ -21,7 +22,7 @@ using MessageCallback =
 using HighWaterMarkCallback =
     std::function<void(const TcpConnectionPtr &, size_t)>;
 
-using TimerCallback = std::function<void()>;
+using TimerCallback = base::SmallFunction<void()>;
 }  // namespace net
 }  // namespace TinyWeb
 
@@ -6,6 +6,7 @@
 #include <functional>
 #include <memory>
 
+#include "../../base/include/SmallFunction.h"
 #include "../../base/include/Timestamp.h"
 #include "../../base/include/noncopyable.h"
 
@@ -15,22 +16,33 @@ class EventLoop;
 
 class Channel : base::noncopyable {
  public:
-  using EventCallback = std::function<void()>;
-  using ReadEventCallback = std::function<void(base::Timestamp)>;
+  using EventCallback = base::SmallFunction<void()>;
+  using ReadEventCallback = base::SmallFunction<void(base::Timestamp)>;
 
   Channel(EventLoop *loop, int fd);
 
   void handleEvent(base::Timestamp receiveTime);
 
-  void setReadCallback(ReadEventCallback cb) { readCallback_ = cb; }
-  void setWriteCallback(EventCallback cb) { writeCallback_ = cb; }
-  void setCloseCallback(EventCallback cb) { closeCallback_ = cb; }
-  void setErrorCallback(EventCallback cb) { errorCallback_ = cb; }
+  void setReadCallback(ReadEventCallback cb) { readCallback_ = std::move(cb); }
+  void setWriteCallback(EventCallback cb) { writeCallback_ = std::move(cb); }
+  void setCloseCallback(EventCallback cb) { closeCallback_ = std::move(cb); }
+  void setErrorCallback(EventCallback cb) { errorCallback_ = std::move(cb); }
 
   void tie(const std::shared_ptr<void> &);
 
   int fd() const { return fd_; }
-  int events() const { return events_; }
+  // 边沿触发时附带 EPOLLET | EPOLLRDHUP，独占唤醒时附带 EPOLLEXCLUSIVE
+  int events() const {
+    if (events_ == kNoneEvent) {
+      return events_;
+    }
+    int events = events_ | (edgeTriggered_ ? kEdgeTriggeredEvent : 0);
+    // EPOLLEXCLUSIVE 不能与 EPOLLPRI、EPOLLRDHUP 等同时使用
+    return exclusive_ ? (events & (EPOLLIN | EPOLLOUT | EPOLLET)) |
+                            kExclusiveEvent
+                      : events;
+  }
+  int revents() const { return revents_; }
   void set_revents(int revt) { revents_ = revt; }
 
   void enableReading() {
@@ -60,8 +72,22 @@ class Channel : base::noncopyable {
   bool isWriting() const { return events_ & kWriteEvent; }
   bool isReading() const { return events_ & kReadEvent; }
 
-  int index() const { return index_; }
-  void set_index(int idx) { index_ = idx; }
+  // 边沿触发下回调方需要读写到 EAGAIN，否则不会再收到通知
+  void setEdgeTriggered(bool on) {
+    edgeTriggered_ = on;
+    if (!isNoneEvent()) {
+      update();
+    }
+  }
+  bool isEdgeTriggered() const { return edgeTriggered_; }
+
+  // 多个 loop 关注同一个 fd 时每次只唤醒其中一个。epoll 不允许对
+  // EPOLLEXCLUSIVE 做 EPOLL_CTL_MOD，需在 enableReading 之前设置且之后不改关注的事件
+  void setExclusive(bool on) { exclusive_ = on; }
+
+  // 由 EventLoop 维护，延迟提交模式下表示已在待提交列表中
+  bool updatePending() const { return updatePending_; }
+  void setUpdatePending(bool on) { updatePending_ = on; }
 
   EventLoop *ownerLoop() { return loop_; }
 
@@ -74,12 +100,17 @@ class Channel : base::noncopyable {
   static const int kNoneEvent = 0;
   static const int kReadEvent = EPOLLIN | EPOLLPRI;
   static const int kWriteEvent = EPOLLOUT;
+  static const int kEdgeTriggeredEvent =
+      static_cast<int>(EPOLLET | EPOLLRDHUP);
+  static const int kExclusiveEvent = static_cast<int>(EPOLLEXCLUSIVE);
 
   EventLoop *loop_;
   const int fd_;
   int events_;
   int revents_;
-  int index_;
+  bool edgeTriggered_;
+  bool exclusive_;
+  bool updatePending_;
 
   std::weak_ptr<void> tie_;
   bool tied_;
@@ -4,10 +4,13 @@
 #include <atomic>
 #include <functional>
 #include <memory>
-#include <mutex>
+#include <string>
 #include <thread>
 #include <vector>
 
+#include "../../base/include/Histogram.h"
+#include "../../base/include/MpscQueue.h"
+#include "../../base/include/SmallFunction.h"
 #include "../../base/include/Timestamp.h"
 #include "../../base/include/noncopyable.h"
 #include "Callbacks.h"
@@ -18,22 +21,50 @@ namespace net {
 
 class Poller;
 class Channel;
+enum class PollerBackend;
 class TimerQueue;
 
 class EventLoop : base::noncopyable {
  public:
-  using Functor = std::function<void()>;
+  // 只可移动，常见的 std::bind/lambda 不分配堆内存
+  using Functor = base::SmallFunction<void()>;
+
+  // 每轮循环的统计，时间单位均为 ns
+  struct Stats {
+    uint64_t iterations = 0;
+    // 阻塞在 poll 中的时间
+    base::Histogram::Snapshot pollWait;
+    // 每轮就绪的 Channel 数
+    base::Histogram::Snapshot activeChannels;
+    // 每轮执行全部 handleEvent 的时间
+    base::Histogram::Snapshot handleEvents;
+    // 每轮执行的 pending functor 数和耗时，没有 functor 的轮次不计入
+    base::Histogram::Snapshot pendingFunctors;
+    base::Histogram::Snapshot pendingFunctorsTime;
+    // 关注事件变更的累计次数，见 Poller::numInterestUpdates
+    uint64_t interestUpdates = 0;
+
+    // 处理事件和 functor 的时间占比，接近 1 说明 loop 已饱和
+    double busyRatio() const;
+    std::string toString() const;
+  };
 
   EventLoop();
+  // 指定 I/O 多路复用后端，默认由环境变量 TINYWEB_POLLER 决定
+  explicit EventLoop(PollerBackend backend);
   ~EventLoop();
 
   void loop();
   void quit();
 
+  // 每次 poll 返回时刷新一次，本轮的回调可直接读取而不必再取时间
   base::Timestamp pollReturnTime() const { return pollReturnTime_; }
+  base::Timestamp pollReturnMonotonic() const { return pollReturnMonotonic_; }
 
   void runInLoop(Functor cb);
   void queueInLoop(Functor cb);
+  // 整批入队，只需一次 CAS 和至多一次唤醒
+  void queueInLoop(std::vector<Functor> cbs);
 
   TimerId runAt(base::Timestamp time, TimerCallback cb);
   TimerId runAfter(double delay, TimerCallback cb);
@@ -42,6 +73,30 @@ class EventLoop : base::noncopyable {
 
   void wakeup();
 
+  // 有事件后先以零超时轮询最多 maxSpinUs 微秒再阻塞，实际窗口随事件间隔调整；
+  // socketBusyPollUs 大于 0 时新连接设置 SO_BUSY_POLL。需在 loop 线程中调用
+  void setBusyPoll(int maxSpinUs, int socketBusyPollUs = 0);
+  int busyPollSocketUs() const { return busyPollSocketUs_; }
+
+  // 开启后 Channel 的关注事件变更只登记，每轮 poll 之前统一提交最终结果，
+  // 同一轮内先开后关的 EPOLLOUT 不再产生系统调用。需在 loop 线程中调用
+  void setLazyChannelUpdates(bool on);
+
+  // 可在任意线程调用
+  Stats stats() const;
+
+  // 当前在本 loop 上的连接数，由 TcpConnection 在 loop 线程中维护，可在任意线程读取
+  int numConnections() const {
+    return numConnections_.load(std::memory_order_relaxed);
+  }
+  void addConnections(int delta) {
+    numConnections_.store(
+        numConnections_.load(std::memory_order_relaxed) + delta,
+        std::memory_order_relaxed);
+  }
+  // 最近几十毫秒内处理事件和 functor 的时间占比，可在任意线程调用
+  double recentBusyRatio() const;
+
   void updateChannel(Channel *channel);
   void removeChannel(Channel *channel);
   bool hasChannel(Channel *channel);
@@ -58,25 +113,72 @@ class EventLoop : base::noncopyable {
  private:
   void abortNotInLoopThread();
   void handleRead();
-  void doPendingFunctors();
+  size_t doPendingFunctors();
+  void wakeupIfNeeded();
+  int pollTimeoutMs() const;
+  void applyChannelUpdates();
+  void updateSpinWindow();
+  void updateRecentBusy(int64_t busyNs, int64_t now);
 
   using ChannelList = std::vector<Channel *>;
 
+  struct NodePool;
+  struct NodeCache;
+  struct PendingFunctor {
+    PendingFunctor(Functor &&f, NodePool *p)
+        : functor(std::move(f)), pool(p) {}
+
+    Functor functor;
+    PendingFunctor *next = nullptr;
+    // 分配该节点的投递线程的节点池，执行完后归还到这里
+    NodePool *const pool;
+  };
+
+  // 节点执行完后归还给投递它的线程，稳定运行时投递任务不分配内存
+  static PendingFunctor *newNode(Functor &&cb);
+  static void recycleNodes(PendingFunctor *node);
+
   std::atomic_bool looping_;
   std::atomic_bool quit_;
+  std::atomic_bool callingPendingFunctors_;
+  // 已写过 wakeupFd_ 且尚未处理，期间的其他投递不再重复唤醒
+  std::atomic_bool wakeupPending_;
   const std::thread::id threadId_;
   base::Timestamp pollReturnTime_;
+  base::Timestamp pollReturnMonotonic_;
   std::unique_ptr<Poller> poller_;
 
-  int wakeupFd_;
-  std::unique_ptr<Channel> wakeupChannel_;
+  int busyPollMaxUs_;
+  int busyPollSocketUs_;
+  // 有事件的两次 poll 之间的平均间隔，单位微秒
+  double avgEventGapUs_;
+  int64_t lastEventUs_;
+  int64_t spinUntilUs_;
 
   ChannelList activeChannels_;
-  std::unique_ptr<TimerQueue> timerQueue_;
+  bool lazyChannelUpdates_;
+  ChannelList dirtyChannels_;
+
+  base::MpscQueue<PendingFunctor> pendingFunctors_;
+
+  // 只由 loop 线程写入
+  std::atomic<uint64_t> iterations_;
+  base::Histogram pollWaitNs_;
+  base::Histogram activeChannelsHist_;
+  base::Histogram handleEventsNs_;
+  base::Histogram pendingFunctorsHist_;
+  base::Histogram pendingFunctorsNs_;
+
+  std::atomic<int> numConnections_;
+  // 每个窗口结束时把忙碌占比并入 recentBusy_
+  int64_t busyWindowStartNs_;
+  int64_t busyWindowNs_;
+  std::atomic<double> recentBusy_;
+  std::atomic<int64_t> recentBusyUpdateNs_;
 
-  std::atomic_bool callingPendingFunctors_;
-  std::vector<Functor> pendingFunctors_;
-  std::mutex mutex_;
+  int wakeupFd_;
+  std::unique_ptr<Channel> wakeupChannel_;
+  std::unique_ptr<TimerQueue> timerQueue_;
 };
 }  // namespace net
 }  // namespace TinyWeb
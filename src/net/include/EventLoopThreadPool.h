@@ -14,18 +14,55 @@ namespace net {
 
 class EventLoop;
 class EventLoopThread;
+class InetAddress;
 
 class EventLoopThreadPool : base::noncopyable {
  public:
   using ThreadInitCallback = std::function<void(EventLoop *)>;
+  // 自定义分配策略，从 loops 中为来自 peerAddr 的新连接选一个
+  using PlacementCallback = std::function<EventLoop *(
+      const std::vector<EventLoop *> &loops, const InetAddress &peerAddr)>;
+
+  // 新连接的分配策略
+  enum Placement {
+    kRoundRobin,
+    // 连接数最少的 loop，遍历所有 loop
+    kLeastConnections,
+    // 随机取两个 loop，选连接数较少的一个
+    kPowerOfTwoConnections,
+    // 随机取两个 loop，选最近忙碌占比较低的一个，适合连接负载差异大的场景
+    kPowerOfTwoBusy,
+    // 按对端 IP 做一致性哈希，同一客户端总落在同一 loop
+    kConsistentHash,
+  };
 
   EventLoopThreadPool(EventLoop *baseLoop, const std::string &nameArg);
 
   void setThreadNum(int numThreads) { numThread_ = numThreads; }
+  // 只对第 loopIndex 个 loop 开启忙轮询，参数含义同 EventLoop::setBusyPoll。
+  // 需在 start() 之前调用；没有 I/O 线程时 0 号为 baseLoop
+  void setBusyPoll(int loopIndex, int maxSpinUs, int socketBusyPollUs = 0);
+  // 将第 loopIndex 个 I/O 线程绑定到 cpus。需在 start() 之前调用
+  void setThreadAffinity(int loopIndex, const std::vector<int> &cpus);
+  // 按 CpuTopology::spreadOrder 把每个 I/O 线程绑定到一个逻辑 CPU，
+  // 物理核优先并在 NUMA 节点间交替；已用 setThreadAffinity 指定的除外
+  void setAutoAffinity(bool on) { autoAffinity_ = on; }
+  // 需在 start() 之前调用
+  void setPlacement(Placement placement) { placement_ = placement; }
+  void setPlacementCallback(const PlacementCallback &cb) {
+    placementCallback_ = cb;
+  }
 
   void start(const ThreadInitCallback &cb = ThreadInitCallback());
 
   EventLoop *getNextLoop();
+  // 按分配策略为新连接选择 loop，只在 baseLoop 线程中调用
+  EventLoop *getLoopForPeer(const InetAddress &peerAddr);
+  // 绑定在该 CPU 上的 loop，没有时返回 nullptr
+  EventLoop *getLoopForCpu(int cpu) const;
+  // 是否有 I/O 线程绑定了 CPU。绑定后线程的内存优先分配在所在 NUMA 节点，
+  // TcpServer 会在 I/O 线程中创建连接对象以使其落在同一节点
+  bool pinned() const { return !cpuLoops_.empty(); }
 
   std::vector<EventLoop *> getAllLoops();
 
@@ -40,6 +77,27 @@ class EventLoopThreadPool : base::noncopyable {
   int next_ = 0;
   std::vector<std::unique_ptr<EventLoopThread>> threads_;
   std::vector<EventLoop *> loops_;
+
+  struct LoopOptions {
+    int maxSpinUs = 0;
+    int socketBusyPollUs = 0;
+    std::vector<int> cpus;
+  };
+  LoopOptions *loopOptions(int loopIndex);
+  size_t randomIndex();
+  EventLoop *lessLoaded(EventLoop *a, EventLoop *b) const;
+  void buildHashRing();
+
+  std::vector<LoopOptions> loopOptions_;
+  bool autoAffinity_ = false;
+  // 下标为 CPU 编号，值为 loops_ 中的下标，-1 表示没有
+  std::vector<int> cpuLoops_;
+
+  Placement placement_ = kRoundRobin;
+  PlacementCallback placementCallback_;
+  uint64_t random_ = 0x9e3779b97f4a7c15ULL;
+  // 一致性哈希环，按哈希值排序，每个 loop 有 kVirtualNodes 个虚拟节点
+  std::vector<std::pair<uint32_t, EventLoop *>> hashRing_;
 };
 }  // namespace net
 }  // namespace TinyWeb
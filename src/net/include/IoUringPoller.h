@@ -0,0 +1,85 @@
+#ifndef SRC_NET_INCLUDE_IOURINGPOLLER_H_
+#define SRC_NET_INCLUDE_IOURINGPOLLER_H_
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define TINYWEB_HAVE_IO_URING 1
+#endif
+#endif
+
+#ifdef TINYWEB_HAVE_IO_URING
+
+#include <linux/io_uring.h>
+
+#include <vector>
+
+#include "Poller.h"
+
+namespace TinyWeb {
+namespace net {
+class Channel;
+
+// 用 io_uring 的 IORING_OP_POLL_ADD 做就绪通知，直接走系统调用不依赖 liburing。
+// 注册、修改和重新挂载都只是写入提交队列，在下一次 poll() 时与等待合并成
+// 一次 io_uring_enter，每轮循环只有一次系统调用。
+class IoUringPoller : public Poller {
+ public:
+  IoUringPoller(EventLoop *);
+  ~IoUringPoller();
+
+  base::Timestamp poll(int timeoutMs, ChannelList *activeChannels) override;
+  void updateChannel(Channel *channel) override;
+  void removeChannel(Channel *channel) override;
+
+  // 内核支持 io_uring 且具备 IORING_FEAT_EXT_ARG（5.11+）
+  static bool isSupported();
+
+ private:
+  static uint64_t token(int fd, uint32_t generation) {
+    return (static_cast<uint64_t>(generation) << 32) |
+           static_cast<uint32_t>(fd);
+  }
+
+  bool setup(unsigned entries, unsigned flags);
+  io_uring_sqe *getSqe();
+  int submit(unsigned waitNr, int timeoutMs);
+  // ChannelEntry::events 为正在等待的 poll 请求关注的事件，0 表示未挂载；
+  // generation 用于丢弃已撤销请求的完成事件
+  void arm(int fd, ChannelEntry *e, int events);
+  void disarm(int fd, ChannelEntry *e);
+  void reconcile(Channel *channel, ChannelEntry *e);
+  void fillActiveChannels(ChannelList *activeChannels);
+
+  static const unsigned kEntries = 256;
+
+  int ringFd_;
+  io_uring_params params_;
+
+  void *sqRing_;
+  size_t sqRingSize_;
+  void *cqRing_;
+  size_t cqRingSize_;
+  io_uring_sqe *sqes_;
+  size_t sqesSize_;
+
+  unsigned *sqHead_;
+  unsigned *sqTail_;
+  unsigned sqMask_;
+  unsigned *sqArray_;
+  unsigned *cqHead_;
+  unsigned *cqTail_;
+  unsigned cqMask_;
+  io_uring_cqe *cqes_;
+
+  // 已写入提交队列但尚未交给内核的 sqe 数
+  unsigned pending_;
+  uint32_t nextGeneration_;
+  // 本轮触发过的 fd，poll 请求是一次性的，下一轮开始前重新挂载
+  std::vector<int> fired_;
+};
+}  // namespace net
+}  // namespace TinyWeb
+
+#endif  // TINYWEB_HAVE_IO_URING
+
+#endif  // SRC_NET_INCLUDE_IOURINGPOLLER_H_
\ No newline at end of file
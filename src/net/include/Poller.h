@@ -1,7 +1,8 @@
 #ifndef SRC_NET_INCLUDE_POLLER_H_
 #define SRC_NET_INCLUDE_POLLER_H_
 
-#include <unordered_map>
+#include <atomic>
+#include <cstdint>
 #include <vector>
 
 #include "../../base/include/Timestamp.h"
@@ -11,6 +12,9 @@ namespace net {
 class Channel;
 class EventLoop;
 
+// kDefault 按环境变量 TINYWEB_POLLER=epoll|io_uring 选择，未设置时为 epoll
+enum class PollerBackend { kDefault, kEpoll, kIoUring };
+
 class Poller {
  public:
   using ChannelList = std::vector<Channel *>;
@@ -23,13 +27,52 @@ class Poller {
   virtual void removeChannel(Channel *channel) = 0;
 
   bool hasChannel(Channel *channel) const;
+  size_t numChannels() const { return numChannels_; }
+  // 提交给内核的关注事件变更次数（epoll_ctl 调用或 io_uring poll 请求），
+  // 可在任意线程读取
+  uint64_t numInterestUpdates() const {
+    return numInterestUpdates_.load(std::memory_order_relaxed);
+  }
 
   static Poller *newDefaultPoll(EventLoop *loop);
+  // 内核不支持 io_uring 时退回 epoll
+  static Poller *newPoller(EventLoop *loop, PollerBackend backend);
 
  protected:
-  using ChannelMap = std::unordered_map<int, Channel *>;
+  enum State { kNew = -1, kAdded = 1, kDeleted = 2 };
+
+  struct ChannelEntry {
+    Channel *channel = nullptr;
+    State state = kNew;
+    // 最近一次提交给内核的事件，相同时不必再提交
+    int events = 0;
+    // 供后端使用，IoUringPoller 存放 poll 请求的代数
+    uint32_t generation = 0;
+  };
+
+  // 返回 fd 对应的表项，fd 超出范围时按块扩容。表项 channel 不是
+  // 传入的 channel 时（包括 fd 被复用）重置为新的表项
+  ChannelEntry &entry(Channel *channel);
+  // 未登记时返回 nullptr
+  ChannelEntry *findEntry(int fd) {
+    if (fd < 0 || static_cast<size_t>(fd) >= channels_.size() ||
+        channels_[fd].channel == nullptr) {
+      return nullptr;
+    }
+    return &channels_[fd];
+  }
+  void eraseEntry(int fd);
+  // 只由 loop 线程调用
+  void countInterestUpdate() {
+    numInterestUpdates_.store(
+        numInterestUpdates_.load(std::memory_order_relaxed) + 1,
+        std::memory_order_relaxed);
+  }
 
-  ChannelMap channels_;
+  // fd 小而密集，直接按 fd 下标索引
+  std::vector<ChannelEntry> channels_;
+  size_t numChannels_;
+  std::atomic<uint64_t> numInterestUpdates_;
   EventLoop *ownerLoop_;
 };
 }  // namespace net
@@ -23,10 +23,17 @@ class Socket : base::noncopyable {
   void setReuseAddr(bool on);
   void setReusePort(bool on);
   void setKeepAlive(bool on);
+  // 阻塞读时在驱动队列上忙等的微秒数，超过 net.core.busy_read 需要 CAP_NET_ADMIN
+  bool setBusyPoll(int usec);
+  // SO_ATTACH_REUSEPORT_CBPF：按处理数据包的 CPU 编号对 groupSize 取模
+  // 选择 SO_REUSEPORT 组内的套接字（按 listen 顺序编号）
+  bool attachReusePortCpuSteering(int groupSize);
 
   static int createNoneblockingFD();
   static int getSocketError(int sockfd);
   static bool isSelfConnect(int sockfd);
+  // 内核处理该连接数据包的 CPU（SO_INCOMING_CPU），未知时返回 -1
+  static int getIncomingCpu(int sockfd);
 
  private:
   const int sockfd_;
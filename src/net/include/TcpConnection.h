@@ -3,6 +3,7 @@
 
 #include <atomic>
 #include <memory>
+#include <mutex>
 #include <string>
 
 #include "../../base/include/noncopyable.h"
@@ -23,7 +24,8 @@ class TcpConnection : base::noncopyable,
                 const InetAddress &localAddr, const InetAddress &peerAddr);
   ~TcpConnection();
 
-  EventLoop *getLoop() const { return loop_; }
+  // 迁移后会变化，可在任意线程调用
+  EventLoop *getLoop() const { return loop_.load(std::memory_order_acquire); }
   const std::string &name() const { return name_; }
   const InetAddress &localAddress() const { return localAddr_; }
   const InetAddress &peerAddress() const { return peerAddr_; }
@@ -49,26 +51,60 @@ class TcpConnection : base::noncopyable,
     highWaterMark_ = highWaterMark;
   }
 
+  // 在 connectEstablished 之前设置，之后读写都一直处理到 EAGAIN
+  void setEdgeTriggered(bool on);
+
   void connectEstablished();
   void connectDestroyed();
 
+  // 把连接移到 target 上继续处理，可在任意线程调用。原 loop 注销 fd 后由
+  // target 重新注册，期间到达的数据留在内核中，输入输出缓冲区随连接一起转移，
+  // 字节流不丢失也不乱序。已投递到原 loop 的任务会被转交给 target，
+  // 其他线程的 send 经 pendingSend_ 排队，与迁移并发时也保持调用顺序
+  void migrateTo(EventLoop *target);
+
+  // 累计读到的字节数，可在任意线程读取，用于按流量挑选迁移的连接
+  uint64_t bytesReceived() const {
+    return bytesReceived_.load(std::memory_order_relaxed);
+  }
+
  private:
   enum StateE { kDisconnected, kConnecting, kConnected, kDisConnecting };
 
   void setState(StateE state) { state_.store(state); }
 
   void handleRead(base::Timestamp receiveTime);
+  void handleReadEdgeTriggered(base::Timestamp receiveTime);
   void handleWrite();
   void handleClose();
   void handleError();
 
   void sendInLoop(const void *data, size_t len);
+  void queueSend(const void *data, size_t len);
+  void flushPendingSend();
+  void writeInLoop(const void *data, size_t len);
+  void flushDeferredOutput();
   void shutdownInLoop();
+  void migrateInLoop(EventLoop *target);
+  void attachInLoop();
+  void addBytesReceived(size_t n) {
+    bytesReceived_.store(bytesReceived_.load(std::memory_order_relaxed) + n,
+                         std::memory_order_relaxed);
+  }
 
-  EventLoop *loop_;
+  std::atomic<EventLoop *> loop_;
   const std::string name_;
   std::atomic_int state_;
   bool reading_;
+  // 边沿触发读取期间 send 只追加到 outputBuffer_，回调结束后一次写出
+  bool deferWrite_;
+  // 已从原 loop 注销、尚未在新 loop 上注册
+  bool migrating_;
+  // 其他线程 send 的数据，尚未写出时 sendQueued_ 为 true
+  std::mutex sendMutex_;
+  std::string pendingSend_;
+  std::atomic_bool sendQueued_;
+  std::atomic<uint64_t> bytesReceived_;
 
   std::unique_ptr<Socket> socket_;
   std::unique_ptr<Channel> channel_;
@@ -5,12 +5,14 @@
 #include <functional>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "../../base/include/noncopyable.h"
 #include "Acceptor.h"
 #include "Callbacks.h"
 #include "EventLoopThreadPool.h"
 #include "InetAddress.h"
+#include "TimerId.h"
 
 namespace TinyWeb {
 namespace net {
@@ -20,7 +22,11 @@ class TcpServer : base::noncopyable {
  public:
   using ThreadInitCallback = std::function<void(EventLoop *)>;
 
-  enum Option { kNoReusePort, kReusePort };
+  // kReusePortPerLoop: 每个 I/O 线程各有一个 SO_REUSEPORT 监听套接字，
+  //   由内核分配连接，在接受连接的线程中处理，不经过 baseLoop；
+  // kExclusiveAccept: 一个监听套接字以 EPOLLEXCLUSIVE 注册到每个 I/O 线程，
+  //   一个连接只唤醒其中一个。没有 I/O 线程时两者都退化为 baseLoop 上的单个 Acceptor
+  enum Option { kNoReusePort, kReusePort, kReusePortPerLoop, kExclusiveAccept };
 
   TcpServer(EventLoop *loop, const InetAddress &listenAddr,
             const std::string &nameArg, Option option = kNoReusePort);
@@ -38,10 +44,40 @@ class TcpServer : base::noncopyable {
   }
 
   void setThreadNum(int numThreads);
+  // 之后建立的连接使用边沿触发
+  void setEdgeTriggered(bool on) { edgeTriggered_ = on; }
+  // 新连接交给绑定在 SO_INCOMING_CPU 所指 CPU 上的 loop，没有则轮询。
+  // 需配合 threadPool()->setAutoAffinity/setThreadAffinity，并让网卡
+  // 队列的中断（RSS/RPS）落在这些 CPU 上
+  void setIncomingCpuRouting(bool on) { incomingCpuRouting_ = on; }
+  // kReusePortPerLoop 下挂载 CBPF 程序，按处理数据包的 CPU 选择监听套接字。
+  // 第 k 个套接字属于绑定在 CPU k 上的 loop，需配合 threadPool()->setAutoAffinity
+  // 或 setThreadAffinity 使 loop 绑在 CPU 0..n-1 上
+  void setReusePortCpuSteering(bool on) { reusePortCpuSteering_ = on; }
+  // 新连接分配到 I/O 线程的策略，见 EventLoopThreadPool::Placement。
+  // 开启 setIncomingCpuRouting 时优先按 CPU 分配
+  void setLoopPlacement(EventLoopThreadPool::Placement placement) {
+    threadPool_->setPlacement(placement);
+  }
+  // 每隔 intervalSec 秒比较各 I/O 线程的 recentBusyRatio，最忙的超过
+  // busyThreshold 且比最闲的高出阈值的一半时，从最忙的 loop 上挑一个连接
+  // 迁到最闲的 loop。按上个周期读到的字节数估算每个连接的负载，选迁移后两个
+  // loop 中较忙者最低的一个，至少降低 10% 才迁移，一个连接独占负载时不会
+  // 来回搬动。需在 start() 之前调用，intervalSec <= 0 关闭
+  void setRebalance(double intervalSec, double busyThreshold = 0.7) {
+    rebalanceInterval_ = intervalSec;
+    rebalanceThreshold_ = busyThreshold;
+  }
+  void setLoopPlacementCallback(
+      const EventLoopThreadPool::PlacementCallback &cb) {
+    threadPool_->setPlacementCallback(cb);
+  }
 
   void start();
 
   EventLoop *getLoop() const { return loop_; }
+  // 用于按 loop 配置，例如 threadPool()->setBusyPoll(...)，需在 start() 之前
+  std::shared_ptr<EventLoopThreadPool> threadPool() { return threadPool_; }
 
   const std::string &name() const { return name_; }
 
@@ -49,8 +85,17 @@ class TcpServer : base::noncopyable {
 
  private:
   void newConnection(int sockfd, const InetAddress &peerAddr);
+  // 在 ioLoop 线程中创建并建立连接
+  void newConnectionInLoop(EventLoop *ioLoop, int sockfd,
+                           const InetAddress &peerAddr);
+  TcpConnectionPtr createConnection(EventLoop *ioLoop, int sockfd,
+                                    const InetAddress &peerAddr);
+  void startLoopAcceptors();
+  void rebalance();
   void removeConnection(const TcpConnectionPtr &conn);
   void removeConnectionInLoop(const TcpConnectionPtr &conn);
+  // 在 conn 所属的 loop 中调用
+  void establishConnection(const TcpConnectionPtr &conn);
 
   using ConnectionMap = std::unordered_map<std::string, TcpConnectionPtr>;
 
@@ -59,7 +104,11 @@ class TcpServer : base::noncopyable {
   const std::string ipPort_;
   const std::string name_;
 
+  const InetAddress listenAddr_;
+  const Option option_;
   std::unique_ptr<Acceptor> acceptor_;
+  // kReusePortPerLoop/kExclusiveAccept 下每个 I/O 线程的 Acceptor
+  std::vector<std::unique_ptr<Acceptor>> loopAcceptors_;
 
   std::shared_ptr<EventLoopThreadPool> threadPool_;
 
@@ -69,9 +118,18 @@ class TcpServer : base::noncopyable {
 
   ThreadInitCallback threadInitCallback_;
 
-  std::atomic_int started_;
+  std::atomic_int nextConnId_;
+  bool edgeTriggered_;
+  bool incomingCpuRouting_;
+  bool reusePortCpuSteering_;
+
+  double rebalanceInterval_;
+  double rebalanceThreshold_;
+  TimerId rebalanceTimer_;
+  // 上个周期各连接的 bytesReceived
+  std::unordered_map<std::string, uint64_t> lastBytesReceived_;
 
-  int nextConnId_;
+  std::atomic_int started_;
   ConnectionMap connections_;
 };
 }  // namespace net
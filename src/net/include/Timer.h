@@ -12,7 +12,7 @@ namespace net {
 class Timer : base::noncopyable {
  public:
   Timer(TimerCallback cb, base::Timestamp when, double interval)
-      : timerCallback_(cb),
+      : timerCallback_(std::move(cb)),
         expiration_(when),
         interval_(interval),
         repeat_(interval > 0),
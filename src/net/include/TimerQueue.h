@@ -21,6 +21,7 @@ class TimerQueue : base::noncopyable {
   explicit TimerQueue(EventLoop *loop);
   ~TimerQueue();
 
+  // when 为 base::Timestamp::monotonic() 时间
   TimerId addTimer(TimerCallback cb, base::Timestamp when, double interval);
 
   void cancel(TimerId timerId);
@@ -36,6 +36,20 @@ class HttpServer {
   void setHttpCallback(const HttpCallback &cb) { httpCallback_ = cb; }
 
   void setThreadNum(int numThreads) { server_.setThreadNum(numThreads); }
+  void setEdgeTriggered(bool on) { server_.setEdgeTriggered(on); }
+  void setIncomingCpuRouting(bool on) { server_.setIncomingCpuRouting(on); }
+  void setReusePortCpuSteering(bool on) {
+    server_.setReusePortCpuSteering(on);
+  }
+  void setLoopPlacement(EventLoopThreadPool::Placement placement) {
+    server_.setLoopPlacement(placement);
+  }
+  void setRebalance(double intervalSec, double busyThreshold = 0.7) {
+    server_.setRebalance(intervalSec, busyThreshold);
+  }
+  std::shared_ptr<EventLoopThreadPool> threadPool() {
+    return server_.threadPool();
+  }
 
   void start() {
     LOG_INFO << "HttpServer[" << server_.name() << "] starts listening on "
@@ -0,0 +1,183 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include "../../base/include/Logging.h"
+#include "../include/Buffer.h"
+#include "../include/EventLoop.h"
+#include "../include/EventLoopThread.h"
+#include "../include/TcpConnection.h"
+#include "../include/TcpServer.h"
+#include "../include/http/HttpServer.h"
+
+using namespace TinyWeb::base;
+using namespace TinyWeb::net;
+using namespace TinyWeb::net::http;
+
+// 统计整个进程的堆分配次数，客户端的收发循环本身不分配内存
+static std::atomic<uint64_t> g_allocs(0);
+
+void* operator new(size_t size) {
+  g_allocs.fetch_add(1, std::memory_order_relaxed);
+  void* p = malloc(size == 0 ? 1 : size);
+  if (p == nullptr) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+static const uint16_t kEchoPort = 18086;
+static const uint16_t kHttpPort = 18087;
+static const uint16_t kWorkerPort = 18088;
+
+int connectTo(uint16_t port) {
+  int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (::connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) <
+      0) {
+    perror("connect");
+    exit(1);
+  }
+  return fd;
+}
+
+void echoClient(int fd, int requests) {
+  char message[64];
+  memset(message, 'x', sizeof(message));
+  char buf[sizeof(message)];
+  for (int i = 0; i < requests; ++i) {
+    ::write(fd, message, sizeof(message));
+    size_t received = 0;
+    while (received < sizeof(message)) {
+      ssize_t n = ::read(fd, buf, sizeof(buf) - received);
+      if (n <= 0) {
+        return;
+      }
+      received += n;
+    }
+  }
+}
+
+void httpClient(int fd, int requests) {
+  static const char kRequest[] =
+      "GET /hello HTTP/1.1\r\nHost: localhost\r\nConnection: Keep-Alive\r\n\r\n";
+  char buf[4096];
+  for (int i = 0; i < requests; ++i) {
+    ::write(fd, kRequest, sizeof(kRequest) - 1);
+    // 读到完整的头部和 Content-Length 指定的正文为止
+    size_t received = 0;
+    size_t total = 0;
+    while (total == 0 || received < total) {
+      ssize_t n = ::read(fd, buf + received, sizeof(buf) - 1 - received);
+      if (n <= 0) {
+        return;
+      }
+      received += n;
+      buf[received] = '\0';
+      const char* end = strstr(buf, "\r\n\r\n");
+      const char* length = strstr(buf, "Content-Length: ");
+      if (total == 0 && end && length) {
+        total = (end - buf) + 4 + atoi(length + 16);
+      }
+    }
+  }
+}
+
+// 建立连接后只统计请求阶段的分配次数
+void run(const char* name, uint16_t port, int connections, int requests,
+         void (*client)(int, int)) {
+  std::vector<int> fds;
+  for (int i = 0; i < connections; ++i) {
+    fds.push_back(connectTo(port));
+  }
+  usleep(100 * 1000);
+
+  uint64_t before = g_allocs.load();
+  std::vector<std::thread> threads;
+  for (int fd : fds) {
+    threads.emplace_back(client, fd, requests);
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  uint64_t allocs = g_allocs.load() - before;
+
+  for (int fd : fds) {
+    ::close(fd);
+  }
+  // 线程对象本身的分配不计入
+  allocs -= std::min<uint64_t>(allocs, connections * 2);
+  double total = static_cast<double>(connections) * requests;
+  printf("%-6s %6d conns %8.0f requests %8.2f allocs/request\n", name,
+         connections, total, allocs / total);
+}
+
+// 用法: AllocBench [connections] [requests per connection]
+int main(int argc, char* argv[]) {
+  int connections = argc > 1 ? atoi(argv[1]) : 4;
+  int requests = argc > 2 ? atoi(argv[2]) : 10000;
+  Logger::setLogLevel(Logger::WARN);
+
+  EventLoopThread loopThread;
+  EventLoop* loop = loopThread.startLoop();
+
+  TcpServer echo(loop, InetAddress(kEchoPort), "AllocBenchEcho");
+  echo.setConnectionCallback([](const TcpConnectionPtr&) {});
+  echo.setMessageCallback(
+      [](const TcpConnectionPtr& conn, Buffer* buf, Timestamp) {
+        conn->send(buf->retrieveAsString(buf->readableBytes()));
+      });
+  echo.setThreadNum(2);
+  echo.start();
+
+  // 回复交给另一个线程发送，覆盖跨线程投递的路径
+  EventLoopThread workerThread;
+  EventLoop* worker = workerThread.startLoop();
+  TcpServer workerEcho(loop, InetAddress(kWorkerPort), "AllocBenchWorker");
+  workerEcho.setConnectionCallback([](const TcpConnectionPtr&) {});
+  workerEcho.setMessageCallback(
+      [worker](const TcpConnectionPtr& conn, Buffer* buf, Timestamp) {
+        // C++11 的 lambda 不能移动捕获，用 std::bind 把消息移动进任务
+        worker->queueInLoop(std::bind(
+            [](const TcpConnectionPtr& c, const std::string& m) { c->send(m); },
+            conn, buf->retrieveAsString(buf->readableBytes())));
+      });
+  workerEcho.setThreadNum(2);
+  workerEcho.start();
+
+  InetAddress httpAddr(kHttpPort);
+  HttpServer http(loop, httpAddr, "AllocBenchHttp");
+  http.Get("/hello", [](const HttpRequest&, HttpResponse* resp) {
+    resp->setStatusCode(HttpResponse::k200Ok);
+    resp->setContentType("text/plain");
+    resp->setStringBody("hello");
+  });
+  http.setThreadNum(2);
+  http.start();
+  usleep(100 * 1000);
+
+  run("echo", kEchoPort, connections, requests, echoClient);
+  run("worker", kWorkerPort, connections, requests, echoClient);
+  run("http", kHttpPort, connections, requests, httpClient);
+
+  usleep(100 * 1000);
+  return 0;
+}
\ No newline at end of file
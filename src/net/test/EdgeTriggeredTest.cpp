@@ -0,0 +1,114 @@
+#include <arpa/inet.h>
+#include <signal.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "../include/Buffer.h"
+#include "../include/EventLoop.h"
+#include "../include/EventLoopThread.h"
+#include "../include/EventLoopThreadPool.h"
+#include "../include/TcpConnection.h"
+#include "../include/TcpServer.h"
+
+using namespace TinyWeb::base;
+using namespace TinyWeb::net;
+
+static const uint16_t kBasePort = 18110;
+
+static int connectTo(uint16_t port) {
+  int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (::connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) <
+      0) {
+    perror("connect");
+    exit(1);
+  }
+  return fd;
+}
+
+// 客户端一次发完后停下等待，服务端每次取走全部数据。不再有新数据到达，
+// 边沿触发时一次事件没有读到 EAGAIN 就再也收不到剩余的数据
+static bool runCase(const char* backend, bool edgeTriggered, uint16_t port,
+                    size_t bytes) {
+  ::setenv("TINYWEB_POLLER", backend, 1);
+  EventLoopThread loopThread;
+  EventLoop* loop = loopThread.startLoop();
+
+  std::atomic<size_t> received(0);
+  TcpServer server(loop, InetAddress(port), "EdgeTriggeredTest");
+  server.setThreadNum(1);
+  server.setEdgeTriggered(edgeTriggered);
+  server.setConnectionCallback([](const TcpConnectionPtr&) {});
+  server.setMessageCallback(
+      [&received](const TcpConnectionPtr&, Buffer* buf, Timestamp) {
+        received += buf->readableBytes();
+        buf->retrieveAll();
+      });
+  server.start();
+  ::usleep(50 * 1000);
+
+  int fd = connectTo(port);
+  std::thread writer([fd, bytes]() {
+    std::vector<char> buf(256 * 1024, 'x');
+    size_t sent = 0;
+    while (sent < bytes) {
+      ssize_t n = ::write(fd, buf.data(), std::min(buf.size(), bytes - sent));
+      if (n <= 0) {
+        return;
+      }
+      sent += n;
+    }
+  });
+
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (received.load() < bytes &&
+         std::chrono::steady_clock::now() < deadline) {
+    ::usleep(1000);
+  }
+  const bool ok = received.load() == bytes;
+  // 服务端停止读取时写线程阻塞在 write，关闭写端让它返回
+  ::shutdown(fd, SHUT_WR);
+  writer.join();
+  ::close(fd);
+  // 关闭连接要经过 TcpServer 所在的 loop，计数归零后才能析构 server
+  EventLoop* ioLoop = server.threadPool()->getAllLoops()[0];
+  for (int i = 0; i < 100 && ioLoop->numConnections() > 0; ++i) {
+    ::usleep(10 * 1000);
+  }
+
+  printf("%-8s %s %8zu bytes received=%zu %s\n", backend,
+         edgeTriggered ? "ET" : "LT", bytes, received.load(),
+         ok ? "OK" : "FAILED");
+  return ok;
+}
+
+int main() {
+  // 写线程阻塞时关闭写端，write 返回 EPIPE 而不是终止进程
+  ::signal(SIGPIPE, SIG_IGN);
+  bool ok = true;
+  // io_uring 退出时异步释放 fd，监听端口不会立即可用，每轮换一个端口
+  uint16_t port = kBasePort;
+  const char* backends[] = {"epoll", "io_uring"};
+  const size_t sizes[] = {1 << 20, 4 << 20, 16 << 20, 32 << 20};
+  for (const char* backend : backends) {
+    for (size_t bytes : sizes) {
+      ok = runCase(backend, true, port++, bytes) && ok;
+      ok = runCase(backend, false, port++, bytes) && ok;
+    }
+  }
+  return ok ? 0 : 1;
+}
\ No newline at end of file
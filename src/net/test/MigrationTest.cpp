@@ -0,0 +1,303 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../include/Buffer.h"
+#include "../include/EventLoop.h"
+#include "../include/EventLoopThread.h"
+#include "../include/EventLoopThreadPool.h"
+#include "../include/TcpConnection.h"
+#include "../include/TcpServer.h"
+
+using namespace TinyWeb::base;
+using namespace TinyWeb::net;
+
+static const uint16_t kBasePort = 18100;
+static const size_t kStreamBytes = 64 * 1024 * 1024;
+static const int kMigrateIntervalUs = 200;
+static const int kSenderThreads = 4;
+static const uint32_t kRecordsPerSender = 100 * 1000;
+static const size_t kRecordSize = 64;
+
+// 按偏移生成的字节流，回显内容可以逐字节校验
+static inline unsigned char patternAt(size_t offset) {
+  return static_cast<unsigned char>((offset * 2654435761u) >> 13);
+}
+
+static int connectTo(uint16_t port) {
+  int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (::connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) <
+      0) {
+    perror("connect");
+    exit(1);
+  }
+  return fd;
+}
+
+static int totalConnections(TcpServer* server) {
+  int total = 0;
+  for (EventLoop* loop : server->threadPool()->getAllLoops()) {
+    total += loop->numConnections();
+  }
+  return total;
+}
+
+// 等待连接关闭，各 loop 的连接计数应回到 0
+static bool waitConnectionsClosed(TcpServer* server) {
+  int connections = 0;
+  for (int i = 0; i < 100; ++i) {
+    ::usleep(10 * 1000);
+    connections = totalConnections(server);
+    if (connections == 0) {
+      return true;
+    }
+  }
+  printf("  %d connections still counted after close\n", connections);
+  return false;
+}
+
+// 不断把连接轮流迁移到各个 I/O loop，直到 done
+static int migrate(TcpServer* server, std::mutex* mutex,
+                   const TcpConnectionPtr* current,
+                   const std::atomic<bool>* done) {
+  std::vector<EventLoop*> loops = server->threadPool()->getAllLoops();
+  size_t next = 0;
+  int migrations = 0;
+  while (!done->load()) {
+    TcpConnectionPtr conn;
+    {
+      std::lock_guard<std::mutex> lock(*mutex);
+      conn = *current;
+    }
+    if (conn) {
+      conn->migrateTo(loops[next++ % loops.size()]);
+      ++migrations;
+    }
+    ::usleep(kMigrateIntervalUs);
+  }
+  return migrations;
+}
+
+// 客户端持续发送 64MB 并校验回显，期间另一个线程不断把连接迁移到其他 loop
+static bool runEchoCase(const char* backend, bool edgeTriggered,
+                        uint16_t port) {
+  ::setenv("TINYWEB_POLLER", backend, 1);
+  EventLoopThread loopThread;
+  EventLoop* loop = loopThread.startLoop();
+
+  std::mutex mutex;
+  TcpConnectionPtr current;
+  TcpServer server(loop, InetAddress(port), "MigrationTest");
+  server.setThreadNum(3);
+  server.setEdgeTriggered(edgeTriggered);
+  server.setConnectionCallback([&](const TcpConnectionPtr& conn) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (conn->connected()) {
+      current = conn;
+    } else {
+      current.reset();
+    }
+  });
+  server.setMessageCallback(
+      [](const TcpConnectionPtr& conn, Buffer* buf, Timestamp) {
+        conn->send(buf->retrieveAsString(buf->readableBytes()));
+      });
+  server.start();
+  ::usleep(50 * 1000);
+
+  int fd = connectTo(port);
+  std::atomic<bool> done(false);
+
+  std::thread writer([fd]() {
+    std::vector<unsigned char> buf(64 * 1024);
+    size_t sent = 0;
+    while (sent < kStreamBytes) {
+      size_t n = std::min(buf.size(), kStreamBytes - sent);
+      for (size_t i = 0; i < n; ++i) {
+        buf[i] = patternAt(sent + i);
+      }
+      ssize_t written = ::write(fd, buf.data(), n);
+      if (written <= 0) {
+        perror("write");
+        return;
+      }
+      sent += written;
+    }
+  });
+
+  int migrations = 0;
+  std::thread migrator([&]() {
+    migrations = migrate(&server, &mutex, &current, &done);
+  });
+
+  std::vector<unsigned char> buf(64 * 1024);
+  size_t received = 0;
+  bool ok = true;
+  while (ok && received < kStreamBytes) {
+    ssize_t n = ::read(fd, buf.data(), buf.size());
+    if (n <= 0) {
+      printf("  read returned %zd after %zu bytes\n", n, received);
+      ok = false;
+      break;
+    }
+    for (ssize_t i = 0; i < n; ++i) {
+      if (buf[i] != patternAt(received + i)) {
+        printf("  mismatch at offset %zu\n", received + i);
+        ok = false;
+        break;
+      }
+    }
+    received += n;
+  }
+
+  done = true;
+  writer.join();
+  migrator.join();
+
+  ::close(fd);
+  ok = waitConnectionsClosed(&server) && ok;
+
+  printf("%-8s %s echo   migrations=%d bytes=%zu %s\n", backend,
+         edgeTriggered ? "ET" : "LT", migrations, received,
+         ok ? "OK" : "FAILED");
+  return ok;
+}
+
+// 多个非 I/O 线程同时调用 send，每条记录带发送线程和序号。迁移期间
+// 同一线程的记录必须按序号到达，不能丢失也不能重复
+static bool runSenderCase(const char* backend, bool edgeTriggered,
+                          uint16_t port) {
+  ::setenv("TINYWEB_POLLER", backend, 1);
+  EventLoopThread loopThread;
+  EventLoop* loop = loopThread.startLoop();
+
+  std::mutex mutex;
+  TcpConnectionPtr current;
+  TcpServer server(loop, InetAddress(port), "MigrationTest");
+  server.setThreadNum(3);
+  server.setEdgeTriggered(edgeTriggered);
+  server.setConnectionCallback([&](const TcpConnectionPtr& conn) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (conn->connected()) {
+      current = conn;
+    } else {
+      current.reset();
+    }
+  });
+  server.setMessageCallback(
+      [](const TcpConnectionPtr&, Buffer* buf, Timestamp) {
+        buf->retrieveAll();
+      });
+  server.start();
+  ::usleep(50 * 1000);
+
+  int fd = connectTo(port);
+  TcpConnectionPtr conn;
+  while (!conn) {
+    ::usleep(1000);
+    std::lock_guard<std::mutex> lock(mutex);
+    conn = current;
+  }
+
+  std::atomic<bool> done(false);
+  int migrations = 0;
+  std::thread migrator([&]() {
+    migrations = migrate(&server, &mutex, &current, &done);
+  });
+
+  std::vector<std::thread> senders;
+  for (int t = 0; t < kSenderThreads; ++t) {
+    senders.emplace_back([conn, t]() {
+      char record[kRecordSize];
+      for (uint32_t seq = 0; seq < kRecordsPerSender; ++seq) {
+        uint32_t header[2] = {static_cast<uint32_t>(t), seq};
+        memcpy(record, header, sizeof(header));
+        memset(record + sizeof(header), static_cast<int>(seq & 0x7f),
+               sizeof(record) - sizeof(header));
+        conn->send(record, sizeof(record));
+      }
+    });
+  }
+
+  const size_t total = kSenderThreads * kRecordsPerSender * kRecordSize;
+  std::vector<uint32_t> nextSeq(kSenderThreads, 0);
+  std::vector<char> buf(kRecordSize * 1024);
+  size_t received = 0;
+  size_t pending = 0;
+  bool ok = true;
+  while (ok && received < total) {
+    ssize_t n = ::read(fd, buf.data() + pending, buf.size() - pending);
+    if (n <= 0) {
+      printf("  read returned %zd after %zu bytes\n", n, received);
+      ok = false;
+      break;
+    }
+    received += n;
+    pending += n;
+    size_t offset = 0;
+    for (; ok && pending - offset >= kRecordSize; offset += kRecordSize) {
+      uint32_t header[2];
+      memcpy(header, buf.data() + offset, sizeof(header));
+      const char* payload = buf.data() + offset + sizeof(header);
+      if (header[0] >= static_cast<uint32_t>(kSenderThreads) ||
+          header[1] != nextSeq[header[0]] ||
+          payload[0] != static_cast<char>(header[1] & 0x7f) ||
+          payload[kRecordSize - sizeof(header) - 1] != payload[0]) {
+        printf("  sender %u record %u out of order at offset %zu\n",
+               header[0], header[1], received - pending + offset);
+        ok = false;
+        break;
+      }
+      ++nextSeq[header[0]];
+    }
+    memmove(buf.data(), buf.data() + offset, pending - offset);
+    pending -= offset;
+  }
+
+  for (std::thread& sender : senders) {
+    sender.join();
+  }
+  done = true;
+  migrator.join();
+  conn.reset();
+
+  ::close(fd);
+  ok = waitConnectionsClosed(&server) && ok;
+
+  printf("%-8s %s sender migrations=%d bytes=%zu %s\n", backend,
+         edgeTriggered ? "ET" : "LT", migrations, received,
+         ok ? "OK" : "FAILED");
+  return ok;
+}
+
+int main() {
+  // 校验失败时客户端提前关闭，服务端继续写会收到 EPIPE 而不是终止进程
+  ::signal(SIGPIPE, SIG_IGN);
+  bool ok = true;
+  // io_uring 退出时异步释放 fd，监听端口不会立即可用，每轮换一个端口
+  uint16_t port = kBasePort;
+  const char* backends[] = {"epoll", "io_uring"};
+  for (const char* backend : backends) {
+    ok = runEchoCase(backend, false, port++) && ok;
+    ok = runEchoCase(backend, true, port++) && ok;
+    ok = runSenderCase(backend, false, port++) && ok;
+    ok = runSenderCase(backend, true, port++) && ok;
+  }
+  return ok ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,370 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../../base/include/Logging.h"
+#include "../include/Buffer.h"
+#include "../include/EventLoop.h"
+#include "../include/EventLoopThread.h"
+#include "../include/TcpConnection.h"
+#include "../include/TcpServer.h"
+#include "../include/http/HttpServer.h"
+
+using namespace TinyWeb::base;
+using namespace TinyWeb::net;
+using namespace TinyWeb::net::http;
+
+static const uint16_t kEchoPort = 18096;
+static const uint16_t kHttpPort = 18097;
+static const uint16_t kConnPort = 18098;
+
+static std::atomic<bool> g_running(true);
+// 每个连接一次发出的请求数，大于 1 时为流水线请求
+static int g_pipeline = 1;
+// HTTP 响应正文的字节数
+static size_t g_bodySize = 5;
+// 新连接分配到 I/O 线程的策略
+static EventLoopThreadPool::Placement g_placement =
+    EventLoopThreadPool::kRoundRobin;
+// 每批请求的往返时间，单位 ns，每个客户端线程一份
+static __thread std::vector<uint32_t>* t_latencies = nullptr;
+
+class LatencyScope {
+ public:
+  LatencyScope() : start_(std::chrono::steady_clock::now()) {}
+  ~LatencyScope() {
+    t_latencies->push_back(static_cast<uint32_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start_)
+            .count()));
+  }
+
+ private:
+  std::chrono::steady_clock::time_point start_;
+};
+
+int connectTo(uint16_t port) {
+  int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (::connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) <
+      0) {
+    perror("connect");
+    exit(1);
+  }
+  return fd;
+}
+
+uint64_t echoClient(int fd) {
+  std::string message(64 * g_pipeline, 'x');
+  std::vector<char> buf(message.size());
+  uint64_t requests = 0;
+  while (g_running.load(std::memory_order_relaxed)) {
+    LatencyScope scope;
+    ::write(fd, message.data(), message.size());
+    size_t received = 0;
+    while (received < message.size()) {
+      ssize_t n = ::read(fd, buf.data(), buf.size() - received);
+      if (n <= 0) {
+        return requests;
+      }
+      received += n;
+    }
+    requests += g_pipeline;
+  }
+  return requests;
+}
+
+uint64_t httpClient(int fd) {
+  static const char kRequest[] =
+      "GET /hello HTTP/1.1\r\nHost: localhost\r\nConnection: Keep-Alive\r\n\r\n";
+  std::string requestBatch;
+  for (int i = 0; i < g_pipeline; ++i) {
+    requestBatch.append(kRequest, sizeof(kRequest) - 1);
+  }
+  std::vector<char> buffer(std::max<size_t>(65536, g_bodySize + 4096));
+  char* buf = buffer.data();
+  uint64_t requests = 0;
+  while (g_running.load(std::memory_order_relaxed)) {
+    LatencyScope scope;
+    ::write(fd, requestBatch.data(), requestBatch.size());
+    // 依次解析响应，未解析完的部分留在 buf 开头
+    int responses = 0;
+    size_t received = 0;
+    while (responses < g_pipeline) {
+      ssize_t n = ::read(fd, buf + received, buffer.size() - 1 - received);
+      if (n <= 0) {
+        return requests;
+      }
+      received += n;
+      buf[received] = '\0';
+      size_t parsed = 0;
+      while (parsed < received) {
+        const char* begin = buf + parsed;
+        const char* end = strstr(begin, "\r\n\r\n");
+        const char* length = strstr(begin, "Content-Length: ");
+        if (!end || !length || length > end) {
+          break;
+        }
+        size_t total = (end - begin) + 4 + atoi(length + 16);
+        if (parsed + total > received) {
+          break;
+        }
+        parsed += total;
+        ++responses;
+      }
+      memmove(buf, buf + parsed, received - parsed);
+      received -= parsed;
+    }
+    requests += g_pipeline;
+  }
+  return requests;
+}
+
+// 短连接：建连、一问一答，服务端先关闭，TIME_WAIT 留在服务端不占客户端端口
+uint64_t connectClient(int) {
+  uint64_t requests = 0;
+  char c = 'x';
+  while (g_running.load(std::memory_order_relaxed)) {
+    LatencyScope scope;
+    int fd = connectTo(kConnPort);
+    bool ok = ::write(fd, &c, 1) == 1 && ::read(fd, &c, 1) == 1 &&
+              ::read(fd, &c, 1) == 0;
+    ::close(fd);
+    if (!ok) {
+      break;
+    }
+    ++requests;
+  }
+  return requests;
+}
+
+// 每个连接一个阻塞的客户端线程，一问一答，统计固定时长内完成的请求数
+uint64_t run(const char* backend, const char* name, uint16_t port,
+             int connections, double seconds, uint64_t (*client)(int)) {
+  std::vector<int> fds;
+  for (int i = 0; i < connections; ++i) {
+    fds.push_back(connectTo(port));
+  }
+  usleep(100 * 1000);
+
+  g_running = true;
+  std::vector<uint64_t> counts(connections);
+  std::vector<std::vector<uint32_t>> latencies(connections);
+  std::vector<std::thread> threads;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < connections; ++i) {
+    threads.emplace_back([&, i]() {
+      t_latencies = &latencies[i];
+      counts[i] = client(fds[i]);
+    });
+  }
+  usleep(static_cast<useconds_t>(seconds * 1000 * 1000));
+  g_running = false;
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  double elapsed = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+
+  for (int fd : fds) {
+    ::close(fd);
+  }
+  uint64_t total = 0;
+  for (uint64_t n : counts) {
+    total += n;
+  }
+  std::vector<uint32_t> all;
+  for (std::vector<uint32_t>& lat : latencies) {
+    all.insert(all.end(), lat.begin(), lat.end());
+  }
+  std::sort(all.begin(), all.end());
+  uint32_t p50 = all.empty() ? 0 : all[all.size() / 2];
+  uint32_t p99 = all.empty() ? 0 : all[all.size() * 99 / 100];
+  printf("%-9s %-5s %6d conns %12.0f requests/s  p50 %6.1f us  p99 %6.1f us\n",
+         backend, name, connections, total / elapsed, p50 / 1000.0,
+         p99 / 1000.0);
+  fflush(stdout);
+  return total;
+}
+
+// 每个 I/O 线程的繁忙程度和每轮的开销，以及平均每个请求的 poll 和
+// 关注事件变更（epoll_ctl）次数。统计是累计值，减去上一次运行的结果
+void printLoopStats(const char* name, EventLoopThreadPool* pool,
+                    uint64_t requests, std::vector<EventLoop::Stats>* last) {
+  std::vector<EventLoop*> loops = pool->getAllLoops();
+  last->resize(loops.size());
+  uint64_t iterations = 0;
+  uint64_t updates = 0;
+  for (size_t i = 0; i < loops.size(); ++i) {
+    EventLoop::Stats stats = loops[i]->stats();
+    printf("  %s loop %zu: iterations %llu busy %.2f active p50 %llu "
+           "handle p99 %llu ns functors p99 %llu ns\n",
+           name, i, static_cast<unsigned long long>(stats.iterations),
+           stats.busyRatio(),
+           static_cast<unsigned long long>(stats.activeChannels.percentile(0.5)),
+           static_cast<unsigned long long>(stats.handleEvents.percentile(0.99)),
+           static_cast<unsigned long long>(
+               stats.pendingFunctorsTime.percentile(0.99)));
+    iterations += stats.iterations - (*last)[i].iterations;
+    updates += stats.interestUpdates - (*last)[i].interestUpdates;
+    (*last)[i] = stats;
+  }
+  printf("  %s per request: %.3f polls %.3f interest updates\n", name,
+         requests ? static_cast<double>(iterations) / requests : 0,
+         requests ? static_cast<double>(updates) / requests : 0);
+  fflush(stdout);
+}
+
+void setLazyChannelUpdates(EventLoopThreadPool* pool) {
+  for (EventLoop* loop : pool->getAllLoops()) {
+    loop->runInLoop([loop]() { loop->setLazyChannelUpdates(true); });
+  }
+}
+
+// 在子进程中以指定后端运行服务端和客户端，避免两次运行相互影响
+void benchBackend(const char* backend, int connections, int threads,
+                  double seconds, bool edgeTriggered, int busyPollUs,
+                  bool lazy, bool pin, TcpServer::Option acceptOption) {
+  pid_t pid = ::fork();
+  if (pid != 0) {
+    int status = 0;
+    ::waitpid(pid, &status, 0);
+    return;
+  }
+
+  ::setenv("TINYWEB_POLLER", backend, 1);
+  EventLoopThread loopThread;
+  EventLoop* loop = loopThread.startLoop();
+
+  TcpServer echo(loop, InetAddress(kEchoPort), "PollerBenchEcho");
+  echo.setConnectionCallback([](const TcpConnectionPtr&) {});
+  echo.setMessageCallback(
+      [](const TcpConnectionPtr& conn, Buffer* buf, Timestamp) {
+        conn->send(buf->retrieveAsString(buf->readableBytes()));
+      });
+  echo.setThreadNum(threads);
+  echo.setEdgeTriggered(edgeTriggered);
+  echo.threadPool()->setAutoAffinity(pin);
+  echo.setIncomingCpuRouting(pin);
+  echo.setLoopPlacement(g_placement);
+  for (int i = 0; i < threads; ++i) {
+    echo.threadPool()->setBusyPoll(i, busyPollUs);
+  }
+  echo.start();
+
+  InetAddress httpAddr(kHttpPort);
+  HttpServer http(loop, httpAddr, "PollerBenchHttp");
+  const std::string body(g_bodySize, 'x');
+  http.Get("/hello", [&body](const HttpRequest&, HttpResponse* resp) {
+    resp->setStatusCode(HttpResponse::k200Ok);
+    resp->setContentType("text/plain");
+    resp->setStringBody(body);
+  });
+  http.setThreadNum(threads);
+  http.setEdgeTriggered(edgeTriggered);
+  http.threadPool()->setAutoAffinity(pin);
+  http.setIncomingCpuRouting(pin);
+  http.setLoopPlacement(g_placement);
+  for (int i = 0; i < threads; ++i) {
+    http.threadPool()->setBusyPoll(i, busyPollUs);
+  }
+  http.start();
+
+  TcpServer conn(loop, InetAddress(kConnPort), "PollerBenchConn", acceptOption);
+  conn.setConnectionCallback([](const TcpConnectionPtr&) {});
+  conn.setMessageCallback(
+      [](const TcpConnectionPtr& c, Buffer* buf, Timestamp) {
+        c->send(buf->retrieveAsString(buf->readableBytes()));
+        c->shutdown();
+      });
+  conn.setThreadNum(threads);
+  conn.threadPool()->setAutoAffinity(pin);
+  conn.setReusePortCpuSteering(pin);
+  conn.setLoopPlacement(g_placement);
+  conn.start();
+  if (lazy) {
+    setLazyChannelUpdates(echo.threadPool().get());
+    setLazyChannelUpdates(http.threadPool().get());
+  }
+  usleep(100 * 1000);
+
+  std::vector<EventLoop::Stats> echoStats;
+  std::vector<EventLoop::Stats> httpStats;
+  printLoopStats("echo", echo.threadPool().get(), 0, &echoStats);
+  printLoopStats("http", http.threadPool().get(), 0, &httpStats);
+  uint64_t requests =
+      run(backend, "echo", kEchoPort, connections, seconds, echoClient);
+  printLoopStats("echo", echo.threadPool().get(), requests, &echoStats);
+  requests = run(backend, "http", kHttpPort, connections, seconds, httpClient);
+  printLoopStats("http", http.threadPool().get(), requests, &httpStats);
+  run(backend, "conn", kConnPort, connections, seconds, connectClient);
+  ::_exit(0);
+}
+
+// 用法: PollerBench [connections] [server threads] [seconds] [pipeline]
+//                   [et] [lazy] [pin] [busy=<max spin us>] [body=<bytes>]
+//                   [accept=single|reuseport|exclusive]
+//                   [place=rr|least|p2c|p2cbusy|hash]
+int main(int argc, char* argv[]) {
+  int connections = argc > 1 ? atoi(argv[1]) : 16;
+  int threads = argc > 2 ? atoi(argv[2]) : 2;
+  double seconds = argc > 3 ? atof(argv[3]) : 3.0;
+  g_pipeline = argc > 4 ? std::max(1, atoi(argv[4])) : 1;
+  bool edgeTriggered = false;
+  int busyPollUs = 0;
+  bool lazy = false;
+  bool pin = false;
+  TcpServer::Option acceptOption = TcpServer::kNoReusePort;
+  for (int i = 5; i < argc; ++i) {
+    if (strcmp(argv[i], "et") == 0) {
+      edgeTriggered = true;
+    } else if (strcmp(argv[i], "lazy") == 0) {
+      lazy = true;
+    } else if (strcmp(argv[i], "pin") == 0) {
+      pin = true;
+    } else if (strncmp(argv[i], "body=", 5) == 0) {
+      g_bodySize = static_cast<size_t>(atol(argv[i] + 5));
+    } else if (strcmp(argv[i], "accept=reuseport") == 0) {
+      acceptOption = TcpServer::kReusePortPerLoop;
+    } else if (strcmp(argv[i], "accept=exclusive") == 0) {
+      acceptOption = TcpServer::kExclusiveAccept;
+    } else if (strncmp(argv[i], "place=", 6) == 0) {
+      const char* placement = argv[i] + 6;
+      if (strcmp(placement, "least") == 0) {
+        g_placement = EventLoopThreadPool::kLeastConnections;
+      } else if (strcmp(placement, "p2c") == 0) {
+        g_placement = EventLoopThreadPool::kPowerOfTwoConnections;
+      } else if (strcmp(placement, "p2cbusy") == 0) {
+        g_placement = EventLoopThreadPool::kPowerOfTwoBusy;
+      } else if (strcmp(placement, "hash") == 0) {
+        g_placement = EventLoopThreadPool::kConsistentHash;
+      }
+    } else if (strncmp(argv[i], "busy=", 5) == 0) {
+      busyPollUs = atoi(argv[i] + 5);
+    }
+  }
+  Logger::setLogLevel(Logger::WARN);
+
+  benchBackend("epoll", connections, threads, seconds, edgeTriggered,
+               busyPollUs, lazy, pin, acceptOption);
+  benchBackend("io_uring", connections, threads, seconds, edgeTriggered,
+               busyPollUs, lazy, pin, acceptOption);
+  return 0;
+}
\ No newline at end of file
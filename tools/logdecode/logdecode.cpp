@@ -0,0 +1,44 @@
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include "../../src/base/include/BinaryLogging.h"
+
+using namespace TinyWeb::base;
+
+static void output(const char* msg, int len) { fwrite(msg, 1, len, stdout); }
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    fprintf(stderr, "Usage: %s <binary log file>...\n", argv[0]);
+    return 1;
+  }
+
+  int errors = 0;
+  for (int i = 1; i < argc; ++i) {
+    std::ifstream in(argv[i], std::ios::binary);
+    if (!in) {
+      fprintf(stderr, "logdecode: cannot open %s\n", argv[i]);
+      ++errors;
+      continue;
+    }
+    std::string data((std::istreambuf_iterator<char>(in)),
+                     std::istreambuf_iterator<char>());
+    if (data.compare(0, BinaryLogDecoder::kMagicLength,
+                     BinaryLogDecoder::kMagic) != 0) {
+      fprintf(stderr, "logdecode: %s is not a binary log\n", argv[i]);
+      ++errors;
+      continue;
+    }
+
+    // 每个滚动文件自带完整的站点定义，逐个文件独立解码
+    BinaryLogDecoder decoder;
+    int bad = decoder.decode(data.data(), data.size(), output);
+    if (bad > 0) {
+      fprintf(stderr, "logdecode: %s: %d undecodable records\n", argv[i], bad);
+      errors += bad;
+    }
+  }
+  return errors == 0 ? 0 : 2;
+}
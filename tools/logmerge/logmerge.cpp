@@ -0,0 +1,132 @@
+#include <zlib.h>
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <queue>
+#include <string>
+#include <vector>
+
+// 按行首时间戳 "YYYY/MM/DD HH:MM:SS.uuuuuu" 多路归并日志分片
+// 没有时间戳的行视为上一条日志的续行，随之输出
+// gzopen 可透明读取未压缩的文件，因此 .log 与 .log.gz 均可作为输入
+
+static const size_t kTimeLength = 26;
+
+class ShardReader {
+ public:
+  explicit ShardReader(const char* filename)
+      : file_(::gzopen(filename, "rb")) {}
+  ~ShardReader() {
+    if (file_) {
+      ::gzclose(file_);
+    }
+  }
+
+  bool ok() const { return file_ != nullptr; }
+
+  // 读取下一条日志(含续行)，结束时返回 false
+  bool next() {
+    record_.clear();
+    if (pending_.empty() && !readLine(&pending_)) {
+      return false;
+    }
+    record_.swap(pending_);
+    pending_.clear();
+    std::string line;
+    while (readLine(&line)) {
+      if (hasTime(line)) {
+        pending_.swap(line);
+        break;
+      }
+      record_ += line;
+    }
+    return true;
+  }
+
+  const std::string& record() const { return record_; }
+
+  // 文件开头没有时间戳的内容排在最前
+  std::string key() const {
+    return hasTime(record_) ? record_.substr(0, kTimeLength) : std::string();
+  }
+
+ private:
+  static bool hasTime(const std::string& line) {
+    static const char kPattern[] = "dddd/dd/dd dd:dd:dd.dddddd";
+    if (line.size() < kTimeLength) {
+      return false;
+    }
+    for (size_t i = 0; i < kTimeLength; ++i) {
+      char c = line[i];
+      if (kPattern[i] == 'd' ? (c < '0' || c > '9') : c != kPattern[i]) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool readLine(std::string* line) {
+    line->clear();
+    char buf[4096];
+    while (::gzgets(file_, buf, sizeof(buf)) != nullptr) {
+      size_t len = strlen(buf);
+      line->append(buf, len);
+      if (len > 0 && buf[len - 1] == '\n') {
+        break;
+      }
+    }
+    return !line->empty();
+  }
+
+  gzFile file_;
+  std::string record_;
+  std::string pending_;
+};
+
+struct Entry {
+  std::string key;
+  size_t index;
+};
+
+// 时间戳相同时按命令行顺序输出，保证结果稳定
+struct EntryGreater {
+  bool operator()(const Entry& lhs, const Entry& rhs) const {
+    int cmp = lhs.key.compare(rhs.key);
+    return cmp > 0 || (cmp == 0 && lhs.index > rhs.index);
+  }
+};
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    fprintf(stderr, "Usage: %s <log file>...\n", argv[0]);
+    return 1;
+  }
+
+  int errors = 0;
+  std::vector<std::unique_ptr<ShardReader>> readers;
+  std::priority_queue<Entry, std::vector<Entry>, EntryGreater> heap;
+  for (int i = 1; i < argc; ++i) {
+    std::unique_ptr<ShardReader> reader(new ShardReader(argv[i]));
+    if (!reader->ok()) {
+      fprintf(stderr, "logmerge: cannot open %s\n", argv[i]);
+      ++errors;
+      continue;
+    }
+    if (reader->next()) {
+      heap.push(Entry{reader->key(), readers.size()});
+    }
+    readers.push_back(std::move(reader));
+  }
+
+  while (!heap.empty()) {
+    size_t index = heap.top().index;
+    heap.pop();
+    ShardReader* reader = readers[index].get();
+    fwrite(reader->record().data(), 1, reader->record().size(), stdout);
+    if (reader->next()) {
+      heap.push(Entry{reader->key(), index});
+    }
+  }
+  return errors == 0 ? 0 : 2;
+}
\ No newline at end of file